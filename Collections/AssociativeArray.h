@@ -126,12 +126,11 @@ class AssociativeArray {
 
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief finds an element with a given key
+  ///
+  /// Lookups do not write to the array, so concurrent readers are safe.
   ////////////////////////////////////////////////////////////////////////////////
 
   const ELEMENT& findKey(const KEY& key) {
-    // update statistics
-    nrFinds++;
-
     // compute the hash
     uint32_t hash = desc.hashKey(key);
 
@@ -141,7 +140,6 @@ class AssociativeArray {
     while (!desc.isEmptyElement(table[i])
         && !desc.isEqualKeyElement(key, table[i])) {
       i = (i + 1) % nrAlloc;
-      nrProbesF++;
     }
 
     // return whatever we found
@@ -153,9 +151,6 @@ class AssociativeArray {
   ////////////////////////////////////////////////////////////////////////////////
 
   const ELEMENT& findElement(const ELEMENT& element) {
-    // update statistics
-    nrFinds++;
-
     // compute the hash
     uint32_t hash = desc.hashElement(element);
 
@@ -165,7 +160,6 @@ class AssociativeArray {
     while (!desc.isEmptyElement(table[i])
         && !desc.isEqualElementElement(element, table[i])) {
       i = (i + 1) % nrAlloc;
-      nrProbesF++;
     }
 
     // return whatever we found
@@ -393,11 +387,9 @@ class AssociativeArray {
 
     nrAlloc = size;
     nrUsed = 0;
-    nrFinds = 0;
     nrAdds = 0;
     nrRems = 0;
     nrResizes = 0;
-    nrProbesF = 0;
     nrProbesA = 0;
     nrProbesD = 0;
     nrProbesR = 0;
@@ -444,12 +436,10 @@ class AssociativeArray {
   size_t nrUsed;  // the number of used entries
   ELEMENT * table;  // the table itself
 
-  size_t nrFinds;  // statistics
   size_t nrAdds;  // statistics
   size_t nrRems;  // statistics
   size_t nrResizes;  // statistics
 
-  size_t nrProbesF;  // statistics
   size_t nrProbesA;  // statistics
   size_t nrProbesD;  // statistics
   size_t nrProbesR;  // statistics
@@ -0,0 +1,172 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#ifndef STOAP_COLLECTIONS_FIXEDVECTOR_H_
+#define STOAP_COLLECTIONS_FIXEDVECTOR_H_ 1
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief vector with a fixed capacity and inline storage
+///
+/// Provides the subset of the std::vector interface used for cell paths.
+/// The items are stored in place, so creating, copying and growing a
+/// FixedVector never allocates. Exceeding the capacity N is a programming
+/// error, callers have to check the size of external input beforehand.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename T, size_t N>
+class FixedVector {
+ public:
+  typedef T value_type;
+  typedef T* iterator;
+  typedef const T* const_iterator;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+
+  FixedVector()
+      : items(),
+        count(0) {
+  }
+
+  explicit FixedVector(size_t n, const T& value = T())
+      : items(),
+        count(0) {
+    resize(n, value);
+  }
+
+  template<typename InputIterator>
+  FixedVector(InputIterator first, InputIterator last)
+      : items(),
+        count(0) {
+    for (; first != last; ++first) {
+      push_back(*first);
+    }
+  }
+
+  static size_t capacity() {
+    return N;
+  }
+
+  size_t size() const {
+    return count;
+  }
+
+  bool empty() const {
+    return count == 0;
+  }
+
+  void push_back(const T& value) {
+    assert(count < N);
+    items[count++] = value;
+  }
+
+  void pop_back() {
+    assert(count > 0);
+    count--;
+  }
+
+  void resize(size_t n, const T& value = T()) {
+    assert(n <= N);
+    if (n > count) {
+      std::fill(items + count, items + n, value);
+    }
+    count = (uint32_t) n;
+  }
+
+  void clear() {
+    count = 0;
+  }
+
+  T& operator[](size_t i) {
+    return items[i];
+  }
+
+  const T& operator[](size_t i) const {
+    return items[i];
+  }
+
+  const T& at(size_t i) const {
+    if (i >= count) {
+      throw std::out_of_range("FixedVector::at");
+    }
+    return items[i];
+  }
+
+  T& back() {
+    return items[count - 1];
+  }
+
+  const T& back() const {
+    return items[count - 1];
+  }
+
+  iterator begin() {
+    return items;
+  }
+
+  iterator end() {
+    return items + count;
+  }
+
+  const_iterator begin() const {
+    return items;
+  }
+
+  const_iterator end() const {
+    return items + count;
+  }
+
+  const T* data() const {
+    return items;
+  }
+
+  bool operator==(const FixedVector& other) const {
+    return count == other.count && std::equal(begin(), end(), other.begin());
+  }
+
+  bool operator!=(const FixedVector& other) const {
+    return !(*this == other);
+  }
+
+  bool operator<(const FixedVector& other) const {
+    return std::lexicographical_compare(begin(), end(), other.begin(),
+                                        other.end());
+  }
+
+ private:
+  T items[N];
+  uint32_t count;
+};
+
+#endif  // STOAP_COLLECTIONS_FIXEDVECTOR_H_
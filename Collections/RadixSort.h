@@ -0,0 +1,90 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#ifndef STOAP_COLLECTIONS_RADIXSORT_H_
+#define STOAP_COLLECTIONS_RADIXSORT_H_ 1
+
+#include <algorithm>
+#include <vector>
+
+#include "Olap.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief stable LSD radix sort on unsigned integer keys
+///
+/// Sorts the items by the key returned by keyOf (uint32_t or uint64_t) one
+/// byte at a time. Passes in which all keys share the same byte are skipped,
+/// so small identifiers only cost as many passes as they have used bytes.
+/// The buffer is used as scratch space and resized as needed. Short inputs
+/// are sorted with std::stable_sort, which gives the same order.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename T, typename KeyFunc>
+void radixSort(vector<T>& items, vector<T>& buffer, KeyFunc keyOf) {
+  typedef decltype(keyOf(items[0])) KeyType;
+  const size_t kMinRadixSize = 256;
+
+  if (items.size() < kMinRadixSize) {
+    std::stable_sort(items.begin(), items.end(),
+                     [&keyOf](const T& a, const T& b) {
+                       return keyOf(a) < keyOf(b);
+                     });
+    return;
+  }
+
+  buffer.resize(items.size());
+  for (size_t shift = 0; shift < sizeof(KeyType) * 8; shift += 8) {
+    size_t offsets[257] = { 0 };
+    for (auto it = items.begin(); it != items.end(); ++it) {
+      ++offsets[((keyOf(*it) >> shift) & 0xFF) + 1];
+    }
+
+    // skip the pass if all keys share this byte
+    bool skip = false;
+    for (size_t b = 1; b <= 256; b++) {
+      if (offsets[b] == items.size()) {
+        skip = true;
+        break;
+      } else if (offsets[b]) {
+        break;
+      }
+    }
+    if (skip) {
+      continue;
+    }
+
+    for (size_t b = 1; b <= 256; b++) {
+      offsets[b] += offsets[b - 1];
+    }
+    for (auto it = items.begin(); it != items.end(); ++it) {
+      buffer[offsets[(keyOf(*it) >> shift) & 0xFF]++] = *it;
+    }
+    items.swap(buffer);
+  }
+}
+
+#endif  // STOAP_COLLECTIONS_RADIXSORT_H_
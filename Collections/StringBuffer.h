@@ -33,6 +33,8 @@
 #define STOAP_COLLECTIONS_STRINGBUFFER_H_ 1
 
 
+#include <float.h>
+#include <math.h>
 #include <stdio.h>
 #include <string>
 #include <algorithm>
@@ -685,12 +687,21 @@ struct StringBuffer {
 #endif
 
   ////////////////////////////////////////////////////////////////////////////////
-  /// @brief appends integer with 8 bits
+  /// @brief appends floating point number
   ///
-  /// This method is implemented here in order to allow inlining.
+  /// The output is identical to printf("%.15g") and to a stream with
+  /// setprecision(numeric_limits<double>::digits10). Values which are printed
+  /// in fixed notation are formatted by appendFixedDecimal, all others by
+  /// snprintf.
   ////////////////////////////////////////////////////////////////////////////////
 
   void appendDecimal(double attr) {
+#if LDBL_MANT_DIG >= 64
+    if (appendFixedDecimal(attr)) {
+      return;
+    }
+#endif
+
     char b[1024];
     size_t written = snprintf(b, sizeof(b) - 1, "%.15g", attr);
 
@@ -703,6 +714,101 @@ struct StringBuffer {
     appendText(b, written);
   }
 
+#if LDBL_MANT_DIG >= 64
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief appends floating point number in fixed notation
+  ///
+  /// Formats values with a decimal exponent between -4 and 14 like "%.15g".
+  /// The value is scaled to 15 integral digits in extended precision, where
+  /// the relative error of the product is below 2^-64. Returns false without
+  /// appending anything if the value is out of range or so close to a
+  /// rounding boundary that the result might differ from snprintf.
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool appendFixedDecimal(double attr) {
+    static const long double kPowers[19] = {
+      1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L, 1e10L,
+      1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L
+    };
+    const int kDigits = 15;
+
+    if (attr == 0.0) {
+      if (signbit(attr)) {
+        appendText("-0", 2);
+      } else {
+        appendChar('0');
+      }
+      return true;
+    }
+
+    long double value = attr < 0 ? -static_cast<long double>(attr) : attr;
+    if (!(value >= 1e-4L && value < 1e15L)) {
+      return false;
+    }
+
+    // decimal exponent, verified by the range check on the scaled value
+    int exponent = -4;
+    long double shifted = value * kPowers[4];
+    while (exponent < kDigits - 1 && shifted >= kPowers[exponent + 5]) {
+      exponent++;
+    }
+
+    long double scaled = value * kPowers[kDigits - 1 - exponent];
+    if (scaled < kPowers[kDigits - 1] + 1
+        || scaled >= kPowers[kDigits] - 1) {
+      return false;
+    }
+
+    long double integral = floorl(scaled);
+    long double fraction = scaled - integral;
+    if (fraction > 0.499L && fraction < 0.501L) {
+      return false;
+    }
+
+    uint64_t mantissa = static_cast<uint64_t>(integral) + (fraction > 0.5L);
+    char digits[kDigits];
+    for (int i = kDigits - 1; i >= 0; i--) {
+      digits[i] = static_cast<char>(mantissa % 10 + '0');
+      mantissa /= 10;
+    }
+
+    int length = kDigits;
+    while (digits[length - 1] == '0') {
+      length--;
+    }
+
+    reserve(kDigits + 7);
+    if (attr < 0) {
+      appendChar0('-');
+    }
+    if (exponent < 0) {
+      appendChar0('0');
+      appendChar0('.');
+      for (int i = -1; i > exponent; i--) {
+        appendChar0('0');
+      }
+      for (int i = 0; i < length; i++) {
+        appendChar0(digits[i]);
+      }
+    } else {
+      for (int i = 0; i <= exponent; i++) {
+        appendChar0(digits[i]);
+      }
+      if (length > exponent + 1) {
+        appendChar0('.');
+        for (int i = exponent + 1; i < length; i++) {
+          appendChar0(digits[i]);
+        }
+      }
+    }
+    *bufferPtr = '\0';
+
+    return true;
+  }
+
+#endif
+
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief appends csv string
   ////////////////////////////////////////////////////////////////////////////////
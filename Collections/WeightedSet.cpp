@@ -49,7 +49,8 @@ Set::Iterator::Iterator(const Set::Iterator &it)
       end(it.end) {
 }
 
-Set::Iterator::Iterator(const SetType::iterator &it, const Set &s, bool end)
+Set::Iterator::Iterator(const SetType::const_iterator &it, const Set &s,
+                        bool end)
     : it(it),
       pos(end ? 0 : it->first),
       par(&s),
@@ -57,8 +58,8 @@ Set::Iterator::Iterator(const SetType::iterator &it, const Set &s, bool end)
       end(end) {
 }
 
-Set::Iterator::Iterator(const SetType::iterator &it, IdentifierType pos,
-                        const Set &s)
+Set::Iterator::Iterator(const SetType::const_iterator &it,
+                        IdentifierType pos, const Set &s)
     : it(it),
       pos(pos),
       par(&s),
@@ -162,12 +163,14 @@ Set::Iterator &Set::Iterator::operator=(const Iterator &it) {
 }
 
 Set::Set()
-    : siz(0) {
+    : siz(0),
+      bitmapBase(0) {
 }
 
-Set::Set(bool full) {
+Set::Set(bool full)
+    : bitmapBase(0) {
   if (full) {
-    ranges.insert(make_pair(0, ALL_IDENTIFIERS ));
+    ranges.push_back(make_pair(0, ALL_IDENTIFIERS ));
     siz = (size_t) -1;
   } else {
     siz = 0;
@@ -176,80 +179,56 @@ Set::Set(bool full) {
 
 Set::Set(const Set &set)
     : ranges(set.ranges),
-      siz(set.siz) {
+      siz(set.siz),
+      bitmap(set.bitmap),
+      bitmapBase(set.bitmapBase) {
+}
+
+Set::SetType::iterator Set::upperRange(IdentifierType id) {
+  return std::upper_bound(
+      ranges.begin(), ranges.end(), id,
+      [](IdentifierType v, const RangeType &range) {return v < range.first;});
+}
+
+Set::SetType::const_iterator Set::upperRange(IdentifierType id) const {
+  return std::upper_bound(
+      ranges.begin(), ranges.end(), id,
+      [](IdentifierType v, const RangeType &range) {return v < range.first;});
 }
 
 bool Set::insert(IdentifierType id) {
-  bool result = false;
+  bitmap.clear();
 
-  SetType::iterator itp = ranges.lower_bound(make_pair(id, 0));
-  if (itp == ranges.end() || itp->first != id) {
-    if (itp != ranges.begin()) {
-      --itp;
+  // ids in ascending order are appended to the last range
+  if (ranges.empty() || ranges.back().second < id) {
+    pushRange(id, id);
+    return true;
+  }
+
+  SetType::iterator next = upperRange(id);
+  SetType::iterator prev = next;
+  bool joinPrev = false;
+  if (next != ranges.begin()) {
+    --prev;
+    if (prev->second >= id) {
+      return false;  // already in the set
     }
+    joinPrev = prev->second + 1 == id;
   }
-  if (itp == ranges.end()) {
-    ranges.insert(make_pair(id, id));
-    ++siz;
-    result = true;
+  bool joinNext = next != ranges.end() && next->first == id + 1;
+
+  if (joinPrev && joinNext) {
+    prev->second = next->second;
+    ranges.erase(next);
+  } else if (joinPrev) {
+    prev->second = id;
+  } else if (joinNext) {
+    next->first = id;
   } else {
-    SetType::iterator tmp;
-    if (itp->second < id) {
-      if (itp->second == id - 1) {
-        tmp = itp;
-        --tmp;
-        tmp = ranges.insert(tmp, make_pair(itp->first, id));
-        ranges.erase(itp);
-        itp = tmp;
-        result = true;
-        siz += 1;
-      }
-      SetType::iterator itn = itp;
-      ++itn;
-      if (itn == ranges.end()) {
-        if (!result) {
-          ranges.insert(itp, make_pair(id, id));
-          ++siz;
-          result = true;
-        }
-      } else {
-        if (itn->first > id) {
-          if (itn->first == id + 1) {
-            tmp = ranges.insert(itp, make_pair(id, itn->second));
-            ranges.erase(itn);
-            itn = tmp;
-            if (!result) {
-              result = true;
-              ++siz;
-            }
-          } else {
-            if (!result) {
-              ranges.insert(itp, make_pair(id, id));
-              ++siz;
-              result = true;
-            }
-          }
-        }
-        if (itp->second == itn->first) {
-          ranges.insert(itp, make_pair(itp->first, itn->second));
-          ranges.erase(itp);
-          ranges.erase(itn);
-        }
-      }
-    } else {
-      if (itp->first > id) {
-        if (id == itp->first - 1) {
-          ranges.insert(make_pair(id, itp->second));
-          ranges.erase(itp);
-        } else {
-          ranges.insert(make_pair(id, id));
-        }
-        ++siz;
-        result = true;
-      }
-    }
+    ranges.insert(next, make_pair(id, id));
   }
-  return result;
+  ++siz;
+  return true;
 }
 
 Set::Iterator Set::begin() const {
@@ -261,14 +240,10 @@ Set::Iterator Set::end() const {
 }
 
 Set::Iterator Set::find(IdentifierType id) const {
-  pair<IdentifierType, IdentifierType> val(id, 0);
-  SetType::iterator it = ranges.lower_bound(val);
-  if (it != ranges.end() && it->first == id) {
-    return Iterator(it, id, *this);
-  }
+  SetType::const_iterator it = upperRange(id);
   if (it != ranges.begin()) {
     --it;
-    if (it->first <= id && it->second >= id) {
+    if (it->second >= id) {
       return Iterator(it, id, *this);
     }
   }
@@ -276,30 +251,28 @@ Set::Iterator Set::find(IdentifierType id) const {
 }
 
 bool Set::isInSet(const IdentifierType id) const {
-  pair<IdentifierType, IdentifierType> val(id, 0);
-  SetType::iterator it = ranges.lower_bound(val);
-  if (it != ranges.end() && it->first == id) {
-    return true;
+  if (!bitmap.empty()) {
+    if (id < bitmapBase) {
+      return false;
+    }
+    size_t offset = id - bitmapBase;
+    return offset < bitmap.size() * 64
+        && ((bitmap[offset >> 6] >> (offset & 63)) & 1);
   }
+  SetType::const_iterator it = upperRange(id);
   if (it != ranges.begin()) {
     --it;
-    if (it->first <= id && it->second >= id) {
-      return true;
-    }
+    return it->second >= id;
   }
   return false;
 }
 
 Set::Iterator Set::lowerBound(IdentifierType id) const {
-  pair<IdentifierType, IdentifierType> val(id, 0);
-  SetType::iterator it = ranges.lower_bound(val);
-  if (it != ranges.end() && it->first == id) {
-    return Iterator(it, id, *this);
-  }
+  SetType::const_iterator it = upperRange(id);
   if (it != ranges.begin()) {
-    SetType::iterator sit = it;
+    SetType::const_iterator sit = it;
     --sit;
-    if (sit->first <= id && sit->second >= id) {
+    if (sit->second >= id) {
       return Iterator(sit, id, *this);
     }
   }
@@ -311,30 +284,24 @@ Set::Iterator Set::lowerBound(IdentifierType id) const {
 
 Set::Iterator Set::erase(const Set::Iterator &it) {
   siz--;
-  if (it.it->first == it.pos) {
-    pair<IdentifierType, IdentifierType> val = *it.it;
-    SetType::iterator tmp = it.it;
-    ++tmp;
-    ranges.erase(it.it);
-    if (val.second != it.pos) {
-      val.first++;
-      return Iterator(ranges.insert(val).first, val.first, *this);
+  bitmap.clear();
+  SetType::iterator range = ranges.begin() + (it.it - ranges.begin());
+  if (range->first == it.pos) {
+    if (range->second != it.pos) {
+      range->first++;
+      return Iterator(range, range->first, *this);
     } else {
-      return Iterator(tmp, *this, tmp == ranges.end());
+      range = ranges.erase(range);
+      return Iterator(range, *this, range == ranges.end());
     }
-  } else if (it.it->second == it.pos) {
-    pair<IdentifierType, IdentifierType> val = *it.it;
-    ranges.erase(it.it);
-    val.second--;
-    return Iterator(ranges.insert(val).first, val.second, *this);
+  } else if (range->second == it.pos) {
+    range->second--;
+    return Iterator(range, range->second, *this);
   } else {
-    pair<IdentifierType, IdentifierType> val1 = *it.it;
-    pair<IdentifierType, IdentifierType> val2 = *it.it;
-    ranges.erase(it.it);
-    val1.second = it.pos - 1;
-    val2.first = it.pos + 1;
-    ranges.insert(val1);
-    return Iterator(ranges.insert(val2).first, val2.first, *this);
+    RangeType upper(it.pos + 1, range->second);
+    range->second = it.pos - 1;
+    range = ranges.insert(range + 1, upper);
+    return Iterator(range, upper.first, *this);
   }
 }
 
@@ -344,14 +311,12 @@ size_t Set::size() const {
 
 void Set::clear() {
   ranges.clear();
+  bitmap.clear();
   siz = 0;
 }
 
 Set::range_iterator Set::rangeLowerBound(IdentifierType id) const {
-  SetType::iterator it = ranges.lower_bound(make_pair(id, 0));
-  if (it != ranges.end() && it->first == id) {
-    return range_iterator(it);
-  }
+  SetType::const_iterator it = upperRange(id);
   if (it != ranges.begin()) {
     --it;
   }
@@ -360,11 +325,48 @@ Set::range_iterator Set::rangeLowerBound(IdentifierType id) const {
 
 void Set::insertRange(IdentifierType low, IdentifierType high) {
   siz += high - low + 1;
-  SetType::iterator it = ranges.end();
-  if (it != ranges.begin()) {
-    --it;
+  bitmap.clear();
+  if (ranges.empty() || ranges.back().first < low) {
+    ranges.push_back(make_pair(low, high));
+  } else {
+    RangeType range(low, high);
+    SetType::iterator it = std::lower_bound(ranges.begin(), ranges.end(),
+                                            range);
+    if (it == ranges.end() || *it != range) {
+      ranges.insert(it, range);
+    }
+  }
+}
+
+void Set::pushRange(IdentifierType low, IdentifierType high) {
+  siz += high - low + 1;
+  bitmap.clear();
+  if (!ranges.empty() && ranges.back().second + 1 == low) {
+    ranges.back().second = high;
+  } else {
+    ranges.push_back(make_pair(low, high));
+  }
+}
+
+// The bitmap is only built if it needs at most four words per range.
+void Set::optimize() {
+  bitmap.clear();
+  if (ranges.size() < kBitmapMinRanges) {
+    return;
+  }
+  bitmapBase = ranges.front().first;
+  size_t bits = (size_t) ranges.back().second - bitmapBase + 1;
+  size_t words = (bits + 63) / 64;
+  if (words > 4 * ranges.size()) {
+    return;
+  }
+  bitmap.resize(words, 0);
+  for (SetType::const_iterator it = ranges.begin(); it != ranges.end(); ++it) {
+    for (size_t id = it->first; id <= it->second; id++) {
+      size_t offset = id - bitmapBase;
+      bitmap[offset >> 6] |= (uint64_t) 1 << (offset & 63);
+    }
   }
-  ranges.insert(it, make_pair(low, high));
 }
 
 bool Set::empty() const {
@@ -381,7 +383,6 @@ bool Set::operator==(const Set &set) const {
 
 bool Set::intersection_check(const Set* set, Set** intersection,
                              Set** complement) const {
-  // TODO(jj): optimize Set::intersection to operate with ranges instead of iterators
   if (complement) {
     (*complement) = new Set();
   }
@@ -390,60 +391,45 @@ bool Set::intersection_check(const Set* set, Set** intersection,
   }
   if (!set) {
     if (intersection) {
+      delete (*intersection);
       (*intersection) = new Set(*this);
     }
     return true;
   }
-  Iterator it1 = begin();
-  Iterator it2 = set->begin();
-  Iterator end1 = end();
-  Iterator end2 = set->end();
+
+  // merge the ranges of both sets, the ranges of the other set which end
+  // before the current range of this set are skipped for good
   bool hasIntersection = false;
-  bool hasComplement = false;
-  for (; it1 != end1 && it2 != end2;) {
-    if (*it1 < *it2) {
-      hasComplement = true;
-      if (complement) {
-        if (!(*complement)) {
-          (*complement) = new Set();
-        }
-        (*complement)->insert(*it1);
-      }
-      ++it1;
-    } else if (*it1 == *it2) {
-      if (intersection) {
-        if (!(*intersection)) {
-          (*intersection) = new Set();
-        }
-        (*intersection)->insert(*it1);
-      }
-      ++it1;
-      ++it2;
+  SetType::const_iterator other = set->ranges.begin();
+  SetType::const_iterator otherEnd = set->ranges.end();
+  for (SetType::const_iterator it = ranges.begin(); it != ranges.end(); ++it) {
+    uint64_t low = it->first;
+    while (other != otherEnd && other->second < it->first) {
+      ++other;
+    }
+    for (SetType::const_iterator o = other;
+        o != otherEnd && o->first <= it->second; ++o) {
+      IdentifierType from = max(o->first, it->first);
+      IdentifierType to = min(o->second, it->second);
       hasIntersection = true;
       if (!intersection && !complement) {
-        return hasIntersection;
+        return true;
       }
-    } else {
-      ++it2;
-    }
-  }
-  if (it1 != end1) {
-    hasComplement = true;
-    if (complement) {
-      if (!(*complement)) {
-        (*complement) = new Set();
+      if (complement && from > low) {
+        (*complement)->pushRange((IdentifierType) low, from - 1);
       }
-      while (it1 != end1) {
-        (*complement)->insert(*it1);
-        hasComplement = true;
-        ++it1;
+      if (intersection) {
+        (*intersection)->pushRange(from, to);
       }
+      low = (uint64_t) to + 1;
+    }
+    if (complement && low <= it->second) {
+      (*complement)->pushRange((IdentifierType) low, it->second);
     }
   }
-  if (!hasComplement && intersection) {
-    (*intersection) = new Set(*this);
-  }
+
   if (!intersection && complement) {
+    delete (*complement);
     (*complement) = new Set(*this);
   }
   return hasIntersection;
@@ -535,84 +521,92 @@ double WeightedSet::rangeWeight(IdentifierType rangeStart) const {
 
 void WeightedSet::pushSorted(IdentifierType low, IdentifierType high,
                              double weight) {
-  if (empty()) {
-    ranges.insert(make_pair(low, high));
-    if (weight != 1) {
-      weights[low] = weight;
-    }
+  bitmap.clear();
+  if (!empty() && ranges.back().second + 1 == low
+      && rangeWeight(ranges.back().first) == weight) {
+    // append
+    ranges.back().second = high;
   } else {
-    SetType::reverse_iterator lastRange = ranges.rbegin();
-    if (lastRange->second + 1 == low
-        && rangeWeight(lastRange->first) == weight) {
-      // append
-      pair<IdentifierType, IdentifierType> val = *lastRange;
-      val.second = high;
-      ranges.erase(--ranges.end());
-      ranges.insert(val);
+    if (empty() || ranges.back().first < low) {
+      ranges.push_back(make_pair(low, high));
     } else {
-      ranges.insert(make_pair(low, high));
-      if (weight != 1) {
-        weights[low] = weight;
-      }
+      RangeType range(low, high);
+      ranges.insert(std::lower_bound(ranges.begin(), ranges.end(), range),
+                    range);
+    }
+    if (weight != 1) {
+      weights[low] = weight;
     }
   }
   siz += high - low + 1;
 }
 
 void WeightedSet::fastAdd(IdentifierType id, double weight) {
-  pair<SetType::iterator, bool> itb = ranges.insert(make_pair(id, id));
-  if (itb.second) {
-    if (weight != 1) {
-      weights[id] = weight;
-    }
-    siz++;
-  } else {
-    map<IdentifierType, double>::iterator it = weights.find(id);
-    if (it == weights.end()) {
+  pending.push_back(IdentifierWeightType(id, weight));
+}
+
+// add a single id, the weights of an id added twice are summed up
+void WeightedSet::addWeight(IdentifierType id, double weight) {
+  SetType::iterator it = upperRange(id);
+  if (it != ranges.begin() && (it - 1)->first == id) {
+    map<IdentifierType, double>::iterator wit = weights.find(id);
+    if (wit == weights.end()) {
       weights[id] = 1 + weight;
     } else {
-      weights[id] += weight;
+      wit->second += weight;
     }
-
     if (weights[id] == 1) {
       weights.erase(weights.find(id));
     }
+  } else {
+    ranges.insert(it, make_pair(id, id));
+    if (weight != 1) {
+      weights[id] = weight;
+    }
+    siz++;
   }
 }
 
 void WeightedSet::consolidate() {
-// consolidates WeightedSet - joins all one-id ranges into valid ranges used in WeightedSet
-  for (SetType::iterator it = ranges.begin(); it != ranges.end(); ++it) {
-    double weight = rangeWeight(it->first);
-
-    while (true) {
-      SetType::iterator next = it;
-      ++next;
-      if (next == ranges.end() || it->second + 1 != next->first) {
-        // no more ids to process or not continuous
-        break;
-      }
-
-      double nextWeight = rangeWeight(next->first);
-      if (nextWeight != weight) {
-        // different weights, cannot be joined
-        break;
+  bitmap.clear();
+
+  // add the ids of the fastAdd() sequence in the order they were given,
+  // ids in ascending order are appended to the ranges
+  std::stable_sort(pending.begin(), pending.end(),
+                   [](const IdentifierWeightType &a,
+                      const IdentifierWeightType &b) {
+                     return a.first < b.first;
+                   });
+  for (auto it = pending.begin(); it != pending.end(); ++it) {
+    if (ranges.empty() || ranges.back().first < it->first) {
+      ranges.push_back(make_pair(it->first, it->first));
+      if (it->second != 1) {
+        weights[it->first] = it->second;
       }
-
-      // next will be joined into it, delete next
-      if (nextWeight != 1) {
-        weights.erase(weights.find(next->first));
+      siz++;
+    } else {
+      addWeight(it->first, it->second);
+    }
+  }
+  pending.clear();
+
+  // join adjacent ranges with equal weights
+  size_t joined = 0;
+  for (size_t next = 0; next < ranges.size(); next++) {
+    if (joined > 0 && ranges[joined - 1].second + 1 == ranges[next].first) {
+      double weight = rangeWeight(ranges[joined - 1].first);
+      double nextWeight = rangeWeight(ranges[next].first);
+      if (nextWeight == weight) {
+        if (nextWeight != 1) {
+          weights.erase(weights.find(ranges[next].first));
+        }
+        ranges[joined - 1].second = ranges[next].second;
+        continue;
       }
-      ranges.erase(next);
-
-      // join
-      pair<IdentifierType, IdentifierType> join = *it;
-      join.second++;
-      ranges.erase(it);
-      pair<SetType::iterator, bool> ins = ranges.insert(join);
-      it = ins.first;
     }
+    ranges[joined++] = ranges[next];
   }
+  ranges.resize(joined);
 }
 
 // optimized insert when push_back is needed
@@ -621,9 +615,9 @@ void WeightedSet::pushSorted(IdentifierType id, double weight) {
 }
 
 void WeightedSet::clear() {
-  ranges.clear();
-  siz = 0;
+  Set::clear();
   weights.clear();
+  pending.clear();
 }
 
 WeightedSet::range_iterator WeightedSet::lastRange() {
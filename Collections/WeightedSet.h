@@ -39,17 +39,29 @@
 
 #include "Olap.h"
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief set of identifiers
+///
+/// The identifiers are stored as a sorted vector of disjoint ranges. Ids
+/// inserted in ascending order are appended in constant time, so a set can
+/// be built from sorted input in linear time. Sets with many ranges can
+/// additionally build a dense bitmap with optimize() for constant time
+/// membership tests; every modification drops the bitmap again.
+////////////////////////////////////////////////////////////////////////////////
+
 class Set {
  public:
-  typedef set<pair<IdentifierType, IdentifierType> > SetType;
+  typedef pair<IdentifierType, IdentifierType> RangeType;
+  typedef vector<RangeType> SetType;
 
   class Iterator : public std::iterator<std::forward_iterator_tag,
       IdentifierType, ptrdiff_t, IdentifierType *, IdentifierType &> {
    public:
     Iterator(const Iterator &it);
     Iterator();
-    Iterator(const SetType::iterator &it, const Set &s, bool end);
-    Iterator(const SetType::iterator &it, IdentifierType pos, const Set &s);
+    Iterator(const SetType::const_iterator &it, const Set &s, bool end);
+    Iterator(const SetType::const_iterator &it, IdentifierType pos,
+             const Set &s);
     Iterator(IdentifierType elemId, bool end);
     IdentifierType operator*() const;
     bool operator!=(const Iterator &it) const;
@@ -139,6 +151,9 @@ class Set {
   range_iterator rangeLowerBound(IdentifierType id) const;
   void insertRange(IdentifierType low, IdentifierType high);
 
+  // build the membership bitmap if the set has many ranges
+  void optimize();
+
   bool empty() const;
   bool operator!=(const Set &set) const;
   bool operator==(const Set &set) const;
@@ -153,8 +168,21 @@ class Set {
  protected:
   static void addAncestor(Set* set, Dimension* dim, IdentifierType elemId);
 
+  // append a range behind the last one, joining adjacent ranges
+  void pushRange(IdentifierType low, IdentifierType high);
+
+  // first range with a lower bound greater than id
+  SetType::iterator upperRange(IdentifierType id);
+  SetType::const_iterator upperRange(IdentifierType id) const;
+
+  static const size_t kBitmapMinRanges = 16;
+
   SetType ranges;
   size_t siz;
+
+  // one bit per id starting at bitmapBase, empty if not built
+  vector<uint64_t> bitmap;
+  IdentifierType bitmapBase;
   friend ostream& operator<<(ostream& ostr, const Set &set);
 };
 
@@ -163,7 +191,8 @@ class WeightedSet : public Set {
 
   class const_iterator : public Set::Iterator {
    public:
-    const_iterator(const SetType::iterator &it, const WeightedSet &s, bool end)
+    const_iterator(const SetType::const_iterator &it, const WeightedSet &s,
+                   bool end)
         : Iterator(it, s, end),
           parent(&s) {
     }
@@ -178,7 +207,7 @@ class WeightedSet : public Set {
 
   class range_iterator : public Set::range_iterator {
    public:
-    range_iterator(const SetType::iterator &it, const WeightedSet &s)
+    range_iterator(const SetType::const_iterator &it, const WeightedSet &s)
         : Set::range_iterator(it),
           it(it),
           parent(&s) {
@@ -223,11 +252,13 @@ class WeightedSet : public Set {
   }
   WeightedSet(const WeightedSet &ws)
       : Set(ws),
-        weights(ws.weights) {
+        weights(ws.weights),
+        pending(ws.pending) {
   }
   WeightedSet(const WeightedSet &ws, double factor)
       : Set(ws),
-        weights(ws.weights) {
+        weights(ws.weights),
+        pending(ws.pending) {
     multiply(factor);
   }
 
@@ -273,7 +304,10 @@ class WeightedSet : public Set {
  private:
   double rangeWeight(IdentifierType rangeStart) const;
 
+  void addWeight(IdentifierType id, double weight);
+
   map<IdentifierType, double> weights;  // weight = 1 if not found
+  vector<IdentifierWeightType> pending;  // ids added by fastAdd()
 };
 
 #endif  // STOAP_COLLECTIONS_WEIGHTEDSET_H_
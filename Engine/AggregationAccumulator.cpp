@@ -0,0 +1,61 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#include "Engine/AggregationAccumulator.h"
+
+#include <vector>
+
+#include "Collections/RadixSort.h"
+
+SortAccumulator::SortAccumulator(const Area* targetArea, DoubleStorage* result)
+    : result(result),
+      packer(targetArea),
+      count(0) {
+  buffer.reserve(kBufferSize);
+}
+
+void SortAccumulator::flush() {
+  if (buffer.empty()) {
+    return;
+  }
+
+  radixSort(buffer, sortBuffer,
+            [](const PositionValue &pv) {return pv.position;});
+
+  vector<PositionValue>::const_iterator it = buffer.begin();
+  while (it != buffer.end()) {
+    uint64_t position = it->position;
+    packer.unpack(position, &key);
+
+    double &value = result->m[key];
+    for (; it != buffer.end() && it->position == position; ++it) {
+      value += it->value;
+    }
+  }
+  count += buffer.size();
+  buffer.clear();
+}
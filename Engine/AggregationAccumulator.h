@@ -0,0 +1,175 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#ifndef STOAP_ENGINE_AGGREGATIONACCUMULATOR_H_
+#define STOAP_ENGINE_AGGREGATIONACCUMULATOR_H_ 1
+
+#include <vector>
+
+#include "Olap.h"
+#include "Olap/Area.h"
+#include "Olap/DoubleStorage.h"
+#include "Engine/PathPacker.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief adds the values of the aggregation directly to the result storage
+////////////////////////////////////////////////////////////////////////////////
+
+class HashAccumulator {
+ public:
+  HashAccumulator(const Area* targetArea, DoubleStorage* result)
+      : result(result),
+        count(0) {
+  }
+
+  void add(const CellKeyType &key, double value) {
+    result->addValue(&key, value);
+    count++;
+  }
+
+  void flush() {
+  }
+
+  // number of values added so far
+  size_t getCount() const {
+    return count;
+  }
+
+ private:
+  DoubleStorage* result;
+  size_t count;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief adds the values of the aggregation to the result storage in batches
+///
+/// The values are collected in batches of kBatchSize entries. Before the
+/// first value of a batch is added, the hash buckets of all its keys are
+/// prefetched, so the cache misses of a batch overlap instead of stalling
+/// one after another.
+/// The values are added in their original order.
+////////////////////////////////////////////////////////////////////////////////
+
+class PrefetchAccumulator {
+ public:
+  static const size_t kBatchSize = 16;
+
+  PrefetchAccumulator(const Area* targetArea, DoubleStorage* result)
+      : result(result),
+        size(0),
+        count(0) {
+  }
+
+  void add(const CellKeyType &key, double value) {
+    keys[size] = key;
+    values[size] = value;
+    if (++size == kBatchSize) {
+      flush();
+    }
+  }
+
+  // prefetch and add the values of the current batch
+  void flush() {
+    for (size_t i = 0; i < size; i++) {
+      result->prefetchBucket(result->getBucket(&keys[i]));
+    }
+    for (size_t i = 0; i < size; i++) {
+      result->addValue(&keys[i], values[i]);
+    }
+    count += size;
+    size = 0;
+  }
+
+  // number of values added so far
+  size_t getCount() const {
+    return count + size;
+  }
+
+ private:
+  DoubleStorage* result;
+  CellKeyType keys[kBatchSize];
+  double values[kBatchSize];
+  size_t size;
+  size_t count;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief collects the values of the aggregation and adds them sorted
+///
+/// Each target key is packed into its 64-bit position within the target
+/// area by a PathPacker. The (position, value) pairs are collected in a
+/// buffer of kBufferSize entries, which is radix sorted when full. Every run
+/// of equal positions then costs a single lookup in the result storage. The
+/// sort is stable and the values of a run are added one by one, so the
+/// results are identical to those of the HashAccumulator.
+////////////////////////////////////////////////////////////////////////////////
+
+class SortAccumulator {
+ public:
+  static const size_t kBufferSize = 1 << 18;
+
+  SortAccumulator(const Area* targetArea, DoubleStorage* result);
+
+  void add(const CellKeyType &key, double value) {
+    buffer.push_back(PositionValue(packer.pack(key), value));
+    if (buffer.size() == kBufferSize) {
+      flush();
+    }
+  }
+
+  // sort the collected values and add them to the result storage
+  void flush();
+
+  // number of values added so far
+  size_t getCount() const {
+    return count + buffer.size();
+  }
+
+ private:
+  struct PositionValue {
+    PositionValue()
+        : position(0),
+          value(0) {
+    }
+    PositionValue(uint64_t position, double value)
+        : position(position),
+          value(value) {
+    }
+    uint64_t position;
+    double value;
+  };
+
+  DoubleStorage* result;
+  PathPacker packer;
+
+  vector<PositionValue> buffer;
+  vector<PositionValue> sortBuffer;
+  CellKeyType key;
+  size_t count;
+};
+
+#endif  // STOAP_ENGINE_AGGREGATIONACCUMULATOR_H_
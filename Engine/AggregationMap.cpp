@@ -31,6 +31,7 @@
 #include "Engine/AggregationMap.h"
 
 //#include "Engine/AggregationProcessor.h"
+#include "Collections/RadixSort.h"
 #include "Collections/WeightedSet.h"
 #include "Exceptions/ErrorException.h"
 
@@ -40,51 +41,62 @@ bool ISWeightNonDefault(const double w) {
   return w != 1.0;
 }
 
+// hash of target ids and weights, default weights don't change the hash
+// so sequences with and without a weight buffer compare equal
+static size_t hashDistributionSequence(const IdentifiersType &targetIds,
+                                       const vector<double> &targetWeights) {
+  size_t seed = targetIds.size();
+  for (IdentifiersType::const_iterator it = targetIds.begin();
+      it != targetIds.end(); ++it) {
+    seed ^= *it + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  }
+  std::hash<double> weightHash;
+  for (size_t i = 0; i < targetWeights.size(); i++) {
+    if (ISWeightNonDefault(targetWeights[i])) {
+      seed ^= (weightHash(targetWeights[i]) ^ i) + 0x9e3779b9 + (seed << 6)
+          + (seed >> 2);
+    }
+  }
+  return seed;
+}
+
+bool AggregationMap::isEqualDistributionSequence(
+    const TargetSequence &dm, const IdentifiersType &targetIds,
+    const vector<double> &targetWeights) const {
+  if (targetIds.size() != dm.length
+      || !equal(targetIds.begin(), targetIds.end(),
+                &targetIdBuffer[0] + dm.startOffset)) {
+    return false;
+  }
+  // missing weights (in either sequence) are 1.0
+  const double *weights =
+      weightBuffer.size() <= dm.startOffset ?
+          0 : &weightBuffer[dm.startOffset];
+  for (uint32_t i = 0; i < dm.length; i++) {
+    double w1 = weights ? weights[i] : 1.0;
+    double w2 = i < targetWeights.size() ? targetWeights[i] : 1.0;
+    if (w1 != w2) {
+      return false;
+    }
+  }
+  return true;
+}
+
 uint32_t AggregationMap::storeDistributionSequence(
     const IdentifierType startId, const IdentifierType nextStartId,
     const IdentifiersType &targetIds, const vector<double> &targetWeights) {
   uint32_t distrMapIndex = uint32_t(-1);
   uint32_t distMapSequenceStart = uint32_t(-1);
 
-  uint32_t newSize = (uint32_t) targetIds.size();
-  uint32_t currentIndex = (uint32_t) distributionMap.size() - 1;
-  // TODO: -jj- duplicities search in AggregationMap disabled because of performance problems
-  for (vector<TargetSequence>::const_reverse_iterator dm = distributionMap
-      .rbegin(); false && dm != distributionMap.rend(); ++dm, currentIndex--) {
-    if (newSize == dm->length) {
-      // compare content
-      if (equal(targetIds.begin(), targetIds.end(),
-                &targetIdBuffer[dm->startOffset])) {
-        //uint32_t currentIndex = dm-distributionMap.rbegin();
-        bool identicalWeights = false;
-        if (targetWeights.empty() && weightBuffer.size() <= dm->startOffset) {
-          // none of weights buffers exist - null == null
-          identicalWeights = true;
-        }
-        if (weightBuffer.size()) {
-          double *findEndIt = &weightBuffer[0]
-              + min(dm->startOffset + dm->length,
-                    (uint32_t) weightBuffer.size());
-          if (!identicalWeights && targetWeights.empty()
-              && std::find_if(&weightBuffer[dm->startOffset], findEndIt,
-                              ISWeightNonDefault) == findEndIt) {
-            // check if weightBuffer contains only 1.0 - null == default_weights
-            identicalWeights = true;
-          }
-        }
-        if (!identicalWeights && targetWeights.size()
-            && weightBuffer.size() >= dm->startOffset + targetWeights.size()
-            && equal(targetWeights.begin(), targetWeights.end(),
-                     &weightBuffer[dm->startOffset])) {
-          // both weight buffers exist - weights == weights
-          identicalWeights = true;
-        }
-        if (identicalWeights) {
-          distrMapIndex = currentIndex;
-          //  LOG(INFO) << "duplicity saves: " << newSize*sizeof(targetIds[0]) << " B" << endl;
-          break;
-        }
-      }
+  // look for an identical sequence stored before
+  size_t hash = hashDistributionSequence(targetIds, targetWeights);
+  typedef SequenceHashType::const_iterator HashIterator;
+  pair<HashIterator, HashIterator> candidates = sequenceHashes.equal_range(hash);
+  for (HashIterator cit = candidates.first; cit != candidates.second; ++cit) {
+    if (isEqualDistributionSequence(distributionMap[cit->second], targetIds,
+                                    targetWeights)) {
+      distrMapIndex = cit->second;
+      break;
     }
   }
 
@@ -93,7 +105,11 @@ uint32_t AggregationMap::storeDistributionSequence(
     // copy sequence to buffers
     distMapSequenceStart = (uint32_t) targetIdBuffer.size();
 
-    if (targetWeights.size()) {
+    // sequences with default weights only are not stored in weightBuffer
+    if (targetWeights.size()
+        && std::find_if(targetWeights.begin(), targetWeights.end(),
+                        ISWeightNonDefault) != targetWeights.end()) {
+      anyWeights = true;
       if (weightBuffer.size() != targetIdBuffer.size()) {
         weightBuffer.resize(targetIdBuffer.size(), 1.0);
       }
@@ -106,6 +122,7 @@ uint32_t AggregationMap::storeDistributionSequence(
     distrMapIndex = (uint32_t) (distributionMap.size());
     distributionMap.push_back(
         TargetSequence(distMapSequenceStart, (uint32_t) targetIds.size()));
+    sequenceHashes.insert(std::make_pair(hash, distrMapIndex));
   }
   if (source2TargetVector.empty()) {
     // update "map"
@@ -203,37 +220,67 @@ struct MapTuple {
 
 void AggregationMap::buildBaseToParentMap(IdentifierType parent,
                                           const WeightedSet *descElems) {
+  base2ParentItems.reserve(base2ParentItems.size() + descElems->size());
   for (WeightedSet::const_iterator it = descElems->begin();
       it != descElems->end(); ++it) {
-    base2ParentMap[it.first()][parent] = it.second();
+    base2ParentItems.push_back(BaseParentItem(it.first(), parent, it.second()));
     minBaseId = min(minBaseId, it.first());
     maxBaseId = max(maxBaseId, it.first());
   }
 }
 
 void AggregationMap::compactSourceToTarget() {
+  anyWeights = false;
   targetIdBuffer.clear();
   weightBuffer.clear();
   distributionMap.clear();
   source2TargetMap.clear();
   source2TargetVector.clear();
+  sequenceHashes.clear();
+
+  // sort by base and parent, the sort is stable so for pairs added twice
+  // the last weight is found at the end of the run
+  BaseParentVector sortBuffer;
+  radixSort(base2ParentItems, sortBuffer,
+            [](const BaseParentItem &item) {return item.sortKey();});
+  BaseParentVector().swap(sortBuffer);
 
-  for (SourceToTargetMapType::iterator stit = base2ParentMap.begin();
-      stit != base2ParentMap.end(); ++stit) {
-    IdentifiersType targetIds;
-    vector<double> targetWeights;
+  IdentifiersType targetIds;
+  vector<double> targetWeights;
+  size_t numBases = 0;
+  size_t numTargets = 0;
 
-    for (TargetMapType::const_iterator tmit = stit->second.begin();
-        tmit != stit->second.end(); ++tmit) {
-      targetIds.push_back(tmit->first);
-      targetWeights.push_back(tmit->second);
+  BaseParentVector::const_iterator it = base2ParentItems.begin();
+  while (it != base2ParentItems.end()) {
+    const IdentifierType baseId = it->base;
+    targetIds.clear();
+    targetWeights.clear();
+
+    for (; it != base2ParentItems.end() && it->base == baseId; ++it) {
+      if (!targetIds.empty() && targetIds.back() == it->parent) {
+        targetWeights.back() = it->weight;
+      } else {
+        targetIds.push_back(it->parent);
+        targetWeights.push_back(it->weight);
+      }
     }
-    SourceToTargetMapType::iterator nit = stit;
-    ++nit;
+
     IdentifierType nextStartId =
-        nit == base2ParentMap.end() ? stit->first + 1 : nit->first;
-    storeDistributionSequence(stit->first, nextStartId, targetIds,
-                              targetWeights);
+        it == base2ParentItems.end() ? baseId + 1 : it->base;
+    storeDistributionSequence(baseId, nextStartId, targetIds, targetWeights);
+    numTargets += targetIds.size();
+    numBases++;
   }
-}
 
+  // the triples and the hash index are only needed while building
+  BaseParentVector().swap(base2ParentItems);
+  SequenceHashType().swap(sequenceHashes);
+
+  if (numTargets > targetIdBuffer.size()) {
+    DLOG(INFO) << "AggregationMap: " << numBases
+               << " base elements share " << distributionMap.size()
+               << " distribution sequences, saving "
+               << (numTargets - targetIdBuffer.size()) * sizeof(IdentifierType)
+               << " B of target ids.";
+  }
+}
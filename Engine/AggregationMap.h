@@ -49,10 +49,18 @@ struct Source2TargetMapItem {
 };
 
 
+struct BaseParentItem {
+	BaseParentItem() : base(0), parent(0), weight(1.0) {}
+	BaseParentItem(IdentifierType base, IdentifierType parent, double weight) : base(base), parent(parent), weight(weight) {}
+	uint64_t sortKey() const {return ((uint64_t) base << 32) | parent;}
+	IdentifierType base;
+	IdentifierType parent;
+	double weight;
+};
+
 class AggregationMap : private map<IdentifierType, const WeightedSet*> {
 public:
-	typedef map<IdentifierType, double> TargetMapType;
-	typedef map<IdentifierType, TargetMapType > SourceToTargetMapType;
+	typedef vector<BaseParentItem> BaseParentVector;
 	static bool DistrMapCmp(const Source2TargetMapItem &i, const Source2TargetMapItem &j) {return (i.sourceRangeBegin < j.sourceRangeBegin);}
 
 	AggregationMap() : minBaseId(NO_IDENTIFIER), maxBaseId(0), anyMultiMap(true), anyWeights(false), singleTarget(NO_IDENTIFIER) {}
@@ -78,7 +86,8 @@ public:
 
 
 private:
-	SourceToTargetMapType base2ParentMap;
+	// (base, parent, weight) triples collected by buildBaseToParentMap - sorted and compacted by compactSourceToTarget
+	BaseParentVector base2ParentItems;
 	IdentifierType minBaseId;
 	IdentifierType maxBaseId;
 	bool anyMultiMap;
@@ -101,8 +110,12 @@ private:
 	// vector for fast parent distribution map lookup
 	vector<uint32_t> source2TargetVector;
 	uint32_t dimPos;
+	// hash of (target ids, weights) to index of distributionMap - used to share identical sequences
+	typedef std::unordered_multimap<size_t, uint32_t> SequenceHashType;
+	SequenceHashType sequenceHashes;
 
 	uint32_t storeDistributionSequence(const IdentifierType startId, const IdentifierType nextStartId, const IdentifiersType &targetIds, const vector<double> &targetWeights);
+	bool isEqualDistributionSequence(const TargetSequence &dm, const IdentifiersType &targetIds, const vector<double> &targetWeights) const;
 public:
 	class TargetReader {
 	public:
@@ -0,0 +1,176 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#include "Engine/AreaFilter.h"
+
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define STOAP_X86_DISPATCH 1
+#endif
+
+AreaFilter::AreaFilter(const Area* area, const ColumnStorage* cells)
+    : selectImpl(detectSelect()),
+      columns(area->dimCount()),
+      bitsets(area->dimCount()),
+      bits(area->dimCount()) {
+  for (size_t d = 0; d < area->dimCount(); d++) {
+    IdentifierType maxId = cells->getMaxIdentifier(d);
+    bitsets[d].resize(maxId / 32 + 1, 0);
+    for (Area::ConstElemIter eit = area->elemBegin(d); eit != area->elemEnd(d);
+        ++eit) {
+      IdentifierType id = *eit;
+      if (id <= maxId) {
+        bitsets[d][id >> 5] |= 1u << (id & 31);
+      }
+    }
+    columns[d] = cells->getColumn(d);
+    bits[d] = bitsets[d].data();
+  }
+}
+
+AreaFilter::SelectType AreaFilter::detectSelect() {
+#ifdef STOAP_X86_DISPATCH
+  if (__builtin_cpu_supports("avx512f")) {
+    return &AreaFilter::selectAvx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return &AreaFilter::selectAvx2;
+  }
+#endif
+  return &AreaFilter::selectScalar;
+}
+
+const char* AreaFilter::getInstructionSet() {
+  SelectType impl = detectSelect();
+  if (impl == &AreaFilter::selectAvx512) {
+    return "AVX-512";
+  } else if (impl == &AreaFilter::selectAvx2) {
+    return "AVX2";
+  }
+  return "scalar";
+}
+
+size_t AreaFilter::selectScalar(size_t begin, size_t end,
+                                uint32_t* selection) const {
+  size_t count = 0;
+  for (size_t i = begin; i < end; i++) {
+    bool inArea = true;
+    for (size_t d = 0; d < columns.size() && inArea; d++) {
+      IdentifierType id = columns[d][i];
+      inArea = (bits[d][id >> 5] >> (id & 31)) & 1;
+    }
+    if (inArea) {
+      selection[count++] = (uint32_t) (i - begin);
+    }
+  }
+  return count;
+}
+
+// test the cells left over by the vectorized loops,
+// the offsets are made relative to the begin of the block
+size_t AreaFilter::selectTail(size_t begin, size_t tail, size_t end,
+                              uint32_t* selection) const {
+  size_t count = selectScalar(tail, end, selection);
+  for (size_t c = 0; c < count; c++) {
+    selection[c] += (uint32_t) (tail - begin);
+  }
+  return count;
+}
+
+#ifdef STOAP_X86_DISPATCH
+
+__attribute__((target("avx2")))
+size_t AreaFilter::selectAvx2(size_t begin, size_t end,
+                              uint32_t* selection) const {
+  const __m256i lowBits = _mm256_set1_epi32(31);
+  size_t count = 0;
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    __m256i mask = _mm256_set1_epi32(1);
+    for (size_t d = 0; d < columns.size(); d++) {
+      __m256i ids = _mm256_loadu_si256((const __m256i*) (columns[d] + i));
+      __m256i words = _mm256_i32gather_epi32((const int*) bits[d],
+                                             _mm256_srli_epi32(ids, 5), 4);
+      mask = _mm256_and_si256(
+          mask, _mm256_srlv_epi32(words, _mm256_and_si256(ids, lowBits)));
+    }
+    unsigned lanes = _mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_slli_epi32(mask, 31)));
+    while (lanes) {
+      selection[count++] = (uint32_t) (i - begin + __builtin_ctz(lanes));
+      lanes &= lanes - 1;
+    }
+  }
+  return count + selectTail(begin, i, end, selection + count);
+}
+
+__attribute__((target("avx512f")))
+size_t AreaFilter::selectAvx512(size_t begin, size_t end,
+                                uint32_t* selection) const {
+  const __m512i lowBits = _mm512_set1_epi32(31);
+  const __m512i one = _mm512_set1_epi32(1);
+  const __m512i lanes = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6,
+                                         5, 4, 3, 2, 1, 0);
+  size_t count = 0;
+  size_t i = begin;
+  for (; i + 16 <= end; i += 16) {
+    __mmask16 mask = 0xFFFF;
+    for (size_t d = 0; d < columns.size() && mask; d++) {
+      // the zero-masked shifts have a defined source for the inactive lanes,
+      // unlike the unmasked ones
+      __m512i ids = _mm512_loadu_si512(columns[d] + i);
+      __m512i words = _mm512_mask_i32gather_epi32(
+          _mm512_setzero_si512(), mask, _mm512_maskz_srli_epi32(mask, ids, 5),
+          bits[d], 4);
+      mask = _mm512_mask_test_epi32_mask(
+          mask,
+          _mm512_maskz_srlv_epi32(mask, words, _mm512_and_si512(ids, lowBits)),
+          one);
+    }
+    _mm512_mask_compressstoreu_epi32(
+        selection + count, mask,
+        _mm512_add_epi32(lanes, _mm512_set1_epi32((int) (i - begin))));
+    count += __builtin_popcount(mask);
+  }
+  return count + selectTail(begin, i, end, selection + count);
+}
+
+#else
+
+size_t AreaFilter::selectAvx2(size_t begin, size_t end,
+                              uint32_t* selection) const {
+  return selectScalar(begin, end, selection);
+}
+
+size_t AreaFilter::selectAvx512(size_t begin, size_t end,
+                                uint32_t* selection) const {
+  return selectScalar(begin, end, selection);
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#ifndef STOAP_ENGINE_AREAFILTER_H_
+#define STOAP_ENGINE_AREAFILTER_H_ 1
+
+#include <vector>
+
+#include "Olap.h"
+#include "Olap/Area.h"
+#include "Olap/ColumnStorage.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief selects the cells of a column storage which are inside an area
+///
+/// Every dimension of the area is converted into a bitset with one bit per
+/// identifier. The cells are tested in blocks of up to kBlockSize cells, the
+/// offsets of the cells inside the area are written to a selection vector.
+/// Depending on the CPU, 16 (AVX-512) or 8 (AVX2) cells are tested at once
+/// by gathering the bitset words of their identifiers; the scalar version
+/// is used on all other CPUs and compilers.
+////////////////////////////////////////////////////////////////////////////////
+
+class AreaFilter {
+ public:
+  static const size_t kBlockSize = 1024;
+
+  AreaFilter(const Area* area, const ColumnStorage* cells);
+
+  // write the offsets (relative to begin) of the cells in [begin, end)
+  // which are inside the area to selection and return their number,
+  // end - begin must not exceed kBlockSize
+  size_t select(size_t begin, size_t end, uint32_t* selection) const {
+    return (this->*selectImpl)(begin, end, selection);
+  }
+
+  // name of the instruction set used by select()
+  static const char* getInstructionSet();
+
+ private:
+  typedef size_t (AreaFilter::*SelectType)(size_t begin, size_t end,
+                                           uint32_t* selection) const;
+
+  size_t selectScalar(size_t begin, size_t end, uint32_t* selection) const;
+  size_t selectAvx2(size_t begin, size_t end, uint32_t* selection) const;
+  size_t selectAvx512(size_t begin, size_t end, uint32_t* selection) const;
+  size_t selectTail(size_t begin, size_t tail, size_t end,
+                    uint32_t* selection) const;
+
+  static SelectType detectSelect();
+
+  SelectType selectImpl;
+  vector<const IdentifierType*> columns;
+  vector<vector<uint32_t> > bitsets;
+  vector<const uint32_t*> bits;
+};
+
+#endif  // STOAP_ENGINE_AREAFILTER_H_
@@ -0,0 +1,153 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#include "Engine/CellScanner.h"
+
+#include <vector>
+
+// remove the base cells which are replaced or removed by the changes of the
+// cube from the selection of a block
+static size_t skipHiddenCells(const uint64_t* hidden, size_t block,
+                              uint32_t* selection, size_t selected) {
+  size_t count = 0;
+  for (size_t s = 0; s < selected; s++) {
+    const size_t row = block + selection[s];
+    if (!((hidden[row / 64] >> (row % 64)) & 1)) {
+      selection[count++] = selection[s];
+    }
+  }
+  return count;
+}
+
+CellScanner::CellScanner(Cube* cube, const Area* area)
+    : cube(cube),
+      area(area),
+      dimCount(area->dimCount()),
+      segment(0),
+      block(0),
+      storage(cube->getStorage()),
+      cell(storage->m.begin()) {
+  segments.push_back(cube->getColumnStorage());
+  for (size_t i = 0; i < cube->getDeltaCount(); i++) {
+    segments.push_back(cube->getDelta(i)->getColumns());
+  }
+  if (segments[0] != NULL) {
+    filter.reset(new AreaFilter(area, segments[0]));
+
+    // the segments list the hidden rows, the scan needs them as a bitmap
+    if (cube->getHiddenCount() > 0) {
+      hiddenCells.resize(segments[0]->size() / 64 + 1, 0);
+      for (size_t i = 0; i < cube->getDeltaCount(); i++) {
+        const vector<size_t>& rows = cube->getDelta(i)->getHiddenRows();
+        for (auto row = rows.begin(); row != rows.end(); ++row) {
+          hiddenCells[*row / 64] |= 1ull << (*row % 64);
+        }
+      }
+    }
+  } else {
+    bufferColumns.resize(dimCount, IdentifiersType(AreaFilter::kBlockSize));
+    bufferValues.resize(AreaFilter::kBlockSize);
+    for (size_t row = 0; row < AreaFilter::kBlockSize; row++) {
+      bufferRows[row] = row;
+    }
+  }
+}
+
+bool CellScanner::next(const IdentifierType** columns, const double** values,
+                       const uint32_t** selection, size_t* selected) {
+  for (; segment < segments.size(); segment++, block = 0) {
+    const ColumnStorage* cells = segments[segment];
+    if (segment == 0 && cells == NULL) {
+      size_t count = readStorage();
+      if (count > 0) {
+        for (size_t d = 0; d < dimCount; d++) {
+          columns[d] = bufferColumns[d].data();
+        }
+        *values = bufferValues.data();
+        *selection = bufferRows;
+        *selected = count;
+        return true;
+      }
+    } else if (cells != NULL && block < cells->size()) {
+      if (block == 0 && segment > 0) {
+        filter.reset(new AreaFilter(area, cells));
+      }
+      size_t count = filter->select(
+          block, min(block + AreaFilter::kBlockSize, cells->size()),
+          selectedRows);
+      if (segment == 0 && !hiddenCells.empty()) {
+        count = skipHiddenCells(hiddenCells.data(), block, selectedRows,
+                                count);
+      } else if (segment > 0 && segment + 1 < segments.size()) {
+        count = skipReplacedCells(segment - 1, cells, count);
+      }
+      for (size_t d = 0; d < dimCount; d++) {
+        columns[d] = cells->getColumn(d) + block;
+      }
+      *values = cells->getValues() + block;
+      *selection = selectedRows;
+      *selected = count;
+      block += AreaFilter::kBlockSize;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t CellScanner::readStorage() {
+  size_t count = 0;
+  bool changed = cube->hasChanges();
+  for (; cell != storage->m.end() && count < AreaFilter::kBlockSize; ++cell) {
+    const CellKeyType* key = &cell->first;
+    if (!area->isInArea(key)) {
+      continue;
+    }
+    // skip the base cells which are replaced or removed by the changes
+    if (changed && cube->getValue(key) != &cell->second) {
+      continue;
+    }
+    for (size_t d = 0; d < dimCount; d++) {
+      bufferColumns[d][count] = (*key)[d];
+    }
+    bufferValues[count] = cell->second;
+    count++;
+  }
+  return count;
+}
+
+size_t CellScanner::skipReplacedCells(size_t delta, const ColumnStorage* cells,
+                                      size_t selected) {
+  size_t count = 0;
+  CellKeyType key;
+  for (size_t s = 0; s < selected; s++) {
+    cells->getKey(block + selectedRows[s], &key);
+    if (!cube->isReplaced(delta, &key)) {
+      selectedRows[count++] = selectedRows[s];
+    }
+  }
+  return count;
+}
@@ -0,0 +1,102 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#ifndef STOAP_ENGINE_CELLSCANNER_H_
+#define STOAP_ENGINE_CELLSCANNER_H_ 1
+
+#include <boost/scoped_ptr.hpp>
+#include <vector>
+
+#include "Olap.h"
+#include "Engine/AreaFilter.h"
+#include "Olap/Area.h"
+#include "Olap/ColumnStorage.h"
+#include "Olap/Cube.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief reads the cells of a cube which are inside an area in blocks
+///
+/// The base cells are read first, then the changed cells of the delta
+/// segments, oldest first. The cells are selected from the column storages
+/// by an AreaFilter, skipping the base rows hidden by the changes and the
+/// cells of a segment replaced by a newer one. A cube without a column
+/// storage is read from its hash map instead: the cells inside the area are
+/// copied into a block buffer, in the same order as the rows of the column
+/// storage.
+////////////////////////////////////////////////////////////////////////////////
+
+class CellScanner {
+ public:
+  CellScanner(Cube* cube, const Area* area);
+
+  // read the next block of cells. columns receives the identifier column of
+  // every dimension and values the value column of the block, selection the
+  // offsets of the cells inside the area in these columns. Returns false
+  // once all cells have been read.
+  bool next(const IdentifierType** columns, const double** values,
+            const uint32_t** selection, size_t* selected);
+
+ private:
+  CellScanner(const CellScanner&);
+  CellScanner& operator=(const CellScanner&);
+
+  typedef google::dense_hash_map<const CellKeyType, double,
+                                 mapops>::const_iterator CellIterator;
+
+  // copy the next cells of the hash map which are inside the area into the
+  // buffer, returns their number
+  size_t readStorage();
+
+  // remove the cells replaced by a newer segment than delta from the
+  // selection of a block of its column storage, returns the remaining number
+  size_t skipReplacedCells(size_t delta, const ColumnStorage* cells,
+                           size_t selected);
+
+  Cube* cube;
+  const Area* area;
+  size_t dimCount;
+
+  // the base cells, then the cells of the delta segments
+  vector<const ColumnStorage*> segments;
+  size_t segment;
+  size_t block;
+  boost::scoped_ptr<AreaFilter> filter;
+  uint32_t selectedRows[AreaFilter::kBlockSize];
+
+  // bitmap of the base rows replaced or removed by the changes, empty if
+  // there are none
+  vector<uint64_t> hiddenCells;
+
+  // the base cells of a cube without a column storage
+  const DoubleStorage* storage;
+  CellIterator cell;
+  vector<IdentifiersType> bufferColumns;
+  vector<double> bufferValues;
+  uint32_t bufferRows[AreaFilter::kBlockSize];
+};
+
+#endif  // STOAP_ENGINE_CELLSCANNER_H_
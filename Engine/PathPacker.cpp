@@ -0,0 +1,56 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#include "Engine/PathPacker.h"
+
+#include <vector>
+
+PathPacker::PathPacker(const Area* area)
+    : ordinals(area->dimCount()),
+      elements(area->dimCount()),
+      stepSizes(area->dimCount()) {
+  uint64_t step = 1;
+  for (size_t dim = area->dimCount(); dim > 0; dim--) {
+    size_t d = dim - 1;
+    for (Area::ConstElemIter eit = area->elemBegin(d);
+        eit != area->elemEnd(d); ++eit) {
+      IdentifierType id = *eit;
+      if (ordinals[d].size() <= id) {
+        ordinals[d].resize(id + 1, 0);
+      }
+      ordinals[d][id] = (uint32_t) elements[d].size();
+      elements[d].push_back(id);
+    }
+    stepSizes[d] = step;
+    step *= elements[d].size();
+  }
+}
+
+bool PathPacker::canPack(const Area* area) {
+  return area->getSize() < (double) ((uint64_t) 1 << 63);
+}
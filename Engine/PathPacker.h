@@ -0,0 +1,79 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#ifndef STOAP_ENGINE_PATHPACKER_H_
+#define STOAP_ENGINE_PATHPACKER_H_ 1
+
+#include <vector>
+
+#include "Olap.h"
+#include "Olap/Area.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief packs the paths of an area into 64-bit positions
+///
+/// The position of a path is its index in the enumeration of the area with
+/// the last dimension changing fastest. As the elements of every dimension
+/// are sorted, the order of the positions is the order of the paths.
+////////////////////////////////////////////////////////////////////////////////
+
+class PathPacker {
+ public:
+  explicit PathPacker(const Area* area);
+
+  uint64_t pack(const CellKeyType &key) const {
+    uint64_t position = 0;
+    for (size_t dim = 0; dim < ordinals.size(); dim++) {
+      position += (uint64_t) ordinals[dim][key[dim]] * stepSizes[dim];
+    }
+    return position;
+  }
+
+  void unpack(uint64_t position, CellKeyType* key) const {
+    key->resize(elements.size());
+    for (size_t dim = 0; dim < elements.size(); dim++) {
+      (*key)[dim] = elements[dim][(position / stepSizes[dim])
+          % elements[dim].size()];
+    }
+  }
+
+  // true if the positions of the area fit into 64 bits
+  static bool canPack(const Area* area);
+
+ private:
+  // element id to ordinal within the area, per dimension
+  vector<vector<uint32_t> > ordinals;
+
+  // ordinal to element id, per dimension
+  vector<IdentifiersType> elements;
+
+  // position step of each dimension, the last dimension changes fastest
+  vector<uint64_t> stepSizes;
+};
+
+#endif  // STOAP_ENGINE_PATHPACKER_H_
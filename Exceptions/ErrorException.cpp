@@ -60,8 +60,12 @@ string ErrorException::getDescriptionErrorType(ErrorType type) {
       return "element name in use";
     case ERROR_INVALID_ELEMENT_NAME:
       return "invalid element name";
+    case ERROR_CUBE_NOT_FOUND:
+      return "cube not found";
     case ERROR_CUBE_EMPTY:
       return "cube empty";
+    case ERROR_CUBE_NOT_LOADED:
+      return "cube not loaded";
     case ERROR_INVALID_AGGR_FUNCTION:
       return "invalid aggregation function";
     case ERROR_SPLASH_DISABLED:
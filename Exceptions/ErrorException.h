@@ -69,8 +69,10 @@ class ErrorException {
     ERROR_INVALID_ELEMENT_NAME = 4006,
 
     // cube related errors
+    ERROR_CUBE_NOT_FOUND = 5000,
     ERROR_CUBE_EMPTY = 5003,
-    ERROR_SPLASH_DISABLED = 5005
+    ERROR_SPLASH_DISABLED = 5005,
+    ERROR_CUBE_NOT_LOADED = 5010
   };
 
  public:
@@ -0,0 +1,106 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#include "InputOutput/BinaryResult.h"
+
+#include <string.h>
+
+#include <string>
+
+#include "Exceptions/ErrorException.h"
+
+const char BinaryResult::kMagic[4] = { 'S', 'T', 'O', 'B' };
+const uint16_t BinaryResult::kVersion;
+const uint16_t BinaryResult::kFlagLittleEndian;
+const size_t BinaryResult::kBlockCells;
+
+uint16_t BinaryResult::getHostFlags() {
+  const uint16_t one = 1;
+  return *reinterpret_cast<const char*>(&one) == 1 ? kFlagLittleEndian : 0;
+}
+
+BinaryResultReader::BinaryResultReader(istream* in)
+    : in(in),
+      position(0),
+      bitmap(0),
+      blockPosition(BinaryResult::kBlockCells) {
+  memset(&header, 0, sizeof(header));
+}
+
+bool BinaryResultReader::readHeader() {
+  in->read(reinterpret_cast<char*>(&header), sizeof(header));
+
+  if (static_cast<size_t>(in->gcount()) < sizeof(header)
+      || memcmp(header.magic, BinaryResult::kMagic, sizeof(header.magic))) {
+    // not a binary answer, return everything as text
+    message.assign(reinterpret_cast<char*>(&header), in->gcount());
+    message.append(std::istreambuf_iterator<char>(*in),
+                   std::istreambuf_iterator<char>());
+    memset(&header, 0, sizeof(header));
+    return false;
+  }
+
+  if (header.version != BinaryResult::kVersion) {
+    throw ErrorException(ErrorException::ERROR_CORRUPT_FILE,
+                         "unsupported binary answer version");
+  }
+  if ((header.flags & BinaryResult::kFlagLittleEndian)
+      != (BinaryResult::getHostFlags() & BinaryResult::kFlagLittleEndian)) {
+    throw ErrorException(ErrorException::ERROR_CORRUPT_FILE,
+                         "binary answer has a different byte order");
+  }
+  return true;
+}
+
+bool BinaryResultReader::next(bool* found, double* value) {
+  if (position == header.cellCount) {
+    return false;
+  }
+  if (blockPosition == BinaryResult::kBlockCells) {
+    readBlock();
+  }
+
+  *found = (bitmap >> blockPosition) & 1;
+  *value = values[blockPosition];
+  blockPosition++;
+  position++;
+  return true;
+}
+
+void BinaryResultReader::readBlock() {
+  size_t cells = static_cast<size_t>(
+      min<uint64_t>(BinaryResult::kBlockCells, header.cellCount - position));
+
+  in->read(reinterpret_cast<char*>(&bitmap), sizeof(bitmap));
+  in->read(reinterpret_cast<char*>(values), cells * sizeof(double));
+  if (!*in) {
+    throw ErrorException(ErrorException::ERROR_CORRUPT_FILE,
+                         "binary answer is truncated");
+  }
+  blockPosition = 0;
+}
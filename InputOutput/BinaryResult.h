@@ -0,0 +1,107 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#ifndef STOAP_INPUTOUTPUT_BINARYRESULT_H_
+#define STOAP_INPUTOUTPUT_BINARYRESULT_H_ 1
+
+#include <string>
+
+#include "Olap.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief binary answer format of the server mode
+///
+/// An answer starts with a Header which holds the number of cells. The cells
+/// follow in request order in blocks of kBlockCells cells: a 64 bit bitmap
+/// with one bit per found cell (bit i for the i-th cell of the block),
+/// followed by one double per cell of the block, which is 0 if the cell was
+/// not found. Only the last block may hold fewer cells. All numbers are
+/// written in the byte order of the server, which is given by the flags.
+////////////////////////////////////////////////////////////////////////////////
+
+class BinaryResult {
+ public:
+  struct Header {
+    char magic[4];
+    uint16_t version;
+    uint16_t flags;
+    uint64_t cellCount;
+  };
+
+  static const char kMagic[4];
+  static const uint16_t kVersion = 1;
+  static const uint16_t kFlagLittleEndian = 1;
+  static const size_t kBlockCells = 64;
+
+  // flags describing the host, set in every answer
+  static uint16_t getHostFlags();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief reference decoder for binary answers
+///
+/// Reads the cells of a binary answer one after another. Answers which do
+/// not start with the binary header (error messages are always sent as
+/// text) are returned as message.
+////////////////////////////////////////////////////////////////////////////////
+
+class BinaryResultReader {
+ public:
+  explicit BinaryResultReader(istream* in);
+
+  // read the header, returns false if the answer is a text message
+  bool readHeader();
+
+  // read the next cell, returns false after the last cell of the answer
+  bool next(bool* found, double* value);
+
+  uint64_t getCellCount() const {
+    return header.cellCount;
+  }
+
+  uint16_t getFlags() const {
+    return header.flags;
+  }
+
+  const string& getMessage() const {
+    return message;
+  }
+
+ private:
+  void readBlock();
+
+  istream* in;
+  BinaryResult::Header header;
+  string message;
+  uint64_t position;
+  uint64_t bitmap;
+  double values[BinaryResult::kBlockCells];
+  size_t blockPosition;
+};
+
+#endif  // STOAP_INPUTOUTPUT_BINARYRESULT_H_
@@ -0,0 +1,93 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#include "InputOutput/FifoStream.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+const size_t FifoStream::Buffer::kBufferSize;
+
+FifoStream::FifoStream(int fd)
+    : ostream(NULL), fd(fd), buffer(fd) {
+  rdbuf(&buffer);
+}
+
+FifoStream::~FifoStream() {
+  buffer.pubsync();
+  ::close(fd);
+}
+
+FifoStream::Buffer::Buffer(int fd)
+    : fd(fd) {
+  setp(bytes, bytes + kBufferSize);
+}
+
+FifoStream::Buffer::int_type FifoStream::Buffer::overflow(int_type c) {
+  if (sync() != 0) {
+    return traits_type::eof();
+  }
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+streamsize FifoStream::Buffer::xsputn(const char* data, streamsize size) {
+  if (size < epptr() - pptr()) {
+    memcpy(pptr(), data, size);
+    pbump(size);
+    return size;
+  }
+  if (sync() != 0 || !writeAll(data, size)) {
+    return 0;
+  }
+  return size;
+}
+
+int FifoStream::Buffer::sync() {
+  bool written = writeAll(pbase(), pptr() - pbase());
+  setp(bytes, bytes + kBufferSize);
+  return written ? 0 : -1;
+}
+
+bool FifoStream::Buffer::writeAll(const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd, data, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    } else if (written <= 0) {
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
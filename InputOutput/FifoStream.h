@@ -0,0 +1,80 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#ifndef STOAP_INPUTOUTPUT_FIFOSTREAM_H_
+#define STOAP_INPUTOUTPUT_FIFOSTREAM_H_ 1
+
+#include <ostream>
+#include <streambuf>
+
+#include "Olap.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief output stream writing to the file descriptor of a FIFO
+///
+/// Small writes are collected in a buffer, so a short answer reaches the
+/// reader with a single write. Writes larger than the buffer, like the chunks
+/// of the ResultWriter, go to the descriptor directly, and so does the buffer
+/// when the stream is flushed. A failed write, e.g. because the reader went
+/// away, sets the badbit. The descriptor is closed by the destructor, which
+/// signals EOF to the reader.
+////////////////////////////////////////////////////////////////////////////////
+
+class FifoStream : public ostream {
+ public:
+  explicit FifoStream(int fd);
+  ~FifoStream();
+
+ private:
+  class Buffer : public std::streambuf {
+   public:
+    static const size_t kBufferSize = 1 << 12;
+
+    explicit Buffer(int fd);
+
+   protected:
+    int_type overflow(int_type c);
+    streamsize xsputn(const char* data, streamsize size);
+    int sync();
+
+   private:
+    // write data to the descriptor, returns false if not all of it was written
+    bool writeAll(const char* data, size_t size);
+
+    int fd;
+    char bytes[kBufferSize];
+  };
+
+  FifoStream(const FifoStream&);
+  FifoStream& operator=(const FifoStream&);
+
+  int fd;
+  Buffer buffer;
+};
+
+#endif  // STOAP_INPUTOUTPUT_FIFOSTREAM_H_
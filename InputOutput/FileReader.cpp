@@ -137,6 +137,101 @@ void FileReader::getRaw(char *p, streamsize size) {
   }
 }
 
+// Returns true if a data line ends inside a value, so that splitString()
+// continues the value on the next line. Follows the quoting rules of
+// splitString(), first and escaped keep its state from line to line.
+static bool isLineContinued(const string& line, bool* first, bool* escaped) {
+  const char seperator = ';';
+  size_t len = line.length();
+
+  for (size_t pos = 0; pos < len; pos++) {
+    char c = line[pos];
+
+    if (*first) {
+      if (c == '"') {
+        *escaped = true;
+        *first = false;
+      } else if (c != seperator) {
+        *first = false;
+      }
+    } else if (*escaped) {
+      if (c == '"' && pos + 1 < len) {
+        pos++;
+        if (line[pos] == seperator) {
+          *first = true;
+          *escaped = false;
+        }
+      }
+    } else if (c == seperator) {
+      *first = true;
+    }
+  }
+
+  return !*first;
+}
+
+void FileReader::indexSections(SectionsType* sections) {
+  FileUtils::paloifstream* input = FileUtils::newIfstream(fileName.fullPath());
+
+  if (input == 0) {
+    throw FileOpenException("could not open file for reading",
+                            fileName.fullPath());
+  }
+
+  string line;
+  streampos offset = 0;
+  int32_t number = 0;
+  bool continued = false;
+  bool first = true;
+  bool escaped = false;
+
+  while (getline(*input, line)) {
+    streampos start = offset;
+    offset += line.size() + (input->eof() ? 0 : 1);
+    number++;
+
+    string::size_type invalidCharPos = 0;  // CTRL+Z removing
+    while ((invalidCharPos = line.find(static_cast<char>(26), invalidCharPos)) != line.npos) {
+      line.erase(invalidCharPos, 1);
+    }
+
+    if (!line.empty() && line[line.size() - 1] == '\r') {
+      line.erase(line.size() - 1);
+    }
+
+    if (continued) {
+      continued = isLineContinued(line, &first, &escaped);
+    } else if (line.empty() || line[0] == '#') {
+      continue;
+    } else if (line[0] == '[') {
+      size_t end = line.find("]", 1);
+      if (end != string::npos) {
+        SectionPosition position;
+        position.offset = start;
+        position.lineNumber = number;
+        sections->insert(make_pair(line.substr(1, end - 1), position));
+      }
+    } else {
+      first = true;
+      escaped = false;
+      continued = isLineContinued(line, &first, &escaped);
+    }
+  }
+
+  input->close();
+  delete input;
+}
+
+void FileReader::seekSection(const SectionPosition& position) {
+  inputFile->clear();
+  inputFile->seekg(position.offset);
+
+  endOfFile = false;
+  lineNumber = position.lineNumber - 1;
+
+  nextLine();
+}
+
 void FileReader::processSection(const string& line) {
   size_t end = line.find("]", 1);
   if (end != string::npos) {
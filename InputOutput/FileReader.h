@@ -66,6 +66,39 @@ class FileReader {
 
   bool openFile(bool throwError, bool skipMessage);
 
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief position of a section line in the file
+  ////////////////////////////////////////////////////////////////////////////////
+
+  struct SectionPosition {
+    SectionPosition()
+        : offset(0),
+          lineNumber(0) {
+    }
+
+    streampos offset;  // byte offset of the section line
+    int32_t lineNumber;  // line number of the section line
+  };
+
+  typedef map<string, SectionPosition> SectionsType;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief collects the positions of all sections of the file
+  ///
+  /// The file is read a second time from the start, without splitting the
+  /// data lines. Lines continued by a quoted value are skipped like by
+  /// nextLine(), so only real section lines are found. If a section occurs
+  /// more than once, its first position is kept.
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void indexSections(SectionsType* sections);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief continues reading at a section line found by indexSections()
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void seekSection(const SectionPosition& position);
+
  public:
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief returns true if the actual line is a data line
@@ -31,6 +31,7 @@
 
 #include "InputOutput/FileUtils.h"
 
+#include <fcntl.h>
 #include <unistd.h>
 #include <utime.h>
 #include <vector>
@@ -78,11 +79,29 @@ bool FileUtils::isReadable(const FileName& fileName) {
   }
 }
 
+time_t FileUtils::getModificationTime(const FileName& fileName) {
+  struct stat info;
+  if (stat(fileName.fullPath().c_str(), &info) != 0) {
+    return 0;
+  }
+  return info.st_mtime;
+}
+
 bool FileUtils::remove(const FileName& fileName) {
   int result = std::remove(fileName.fullPath().c_str());
   return (result != 0) ? false : true;
 }
 
+bool FileUtils::sync(const string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  int result = fsync(fd);
+  close(fd);
+  return (result != 0) ? false : true;
+}
+
 bool FileUtils::rename(const FileName& oldName, const FileName& newName) {
   int result = std::rename(oldName.fullPath().c_str(),
                            newName.fullPath().c_str());
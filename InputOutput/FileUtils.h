@@ -73,11 +73,21 @@ class FileUtils {
   ////////////////////////////////////////////////////////////////////////////////
   static bool isReadable(const FileName& fileName);
 
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief returns the modification time of a file, 0 if it does not exist
+  ////////////////////////////////////////////////////////////////////////////////
+  static time_t getModificationTime(const FileName& fileName);
+
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief returns true if a file could be removed
   ////////////////////////////////////////////////////////////////////////////////
   static bool remove(const FileName& fileName);
 
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief returns true if a file or directory could be written to the disk
+  ////////////////////////////////////////////////////////////////////////////////
+  static bool sync(const std::string& path);
+
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief returns true if a file could be renamed
   ////////////////////////////////////////////////////////////////////////////////
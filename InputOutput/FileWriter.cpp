@@ -32,6 +32,7 @@
 #include "InputOutput/FileWriter.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #ifdef HAVE_SYS_TIME_H
 #include <sys/time.h>
 #endif
@@ -52,7 +53,8 @@ extern "C" {
 // #include "Engine/Area.h"
 
 FileWriter::FileWriter(const FileName& fileName):
-      outputFile(0) {
+      outputFile(0),
+      fileName(fileName) {
   setFirstValue(true);
 }
 
@@ -256,9 +258,15 @@ void FileWriter::appendDouble(const double value, char terminator) {
     return;
   }
 
-  outputFile->precision(15);
+  // 15 digits are enough for most values, the others need 17 digits to be
+  // read back exactly
+  char text[32];
+  snprintf(text, sizeof(text), "%.15g", value);
+  if (strtod(text, NULL) != value) {
+    snprintf(text, sizeof(text), "%.17g", value);
+  }
 
-  *outputFile << value;
+  *outputFile << text;
   if (terminator) {
     *outputFile << terminator;
   }
@@ -0,0 +1,365 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#include "InputOutput/Journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/crc.hpp>
+
+#include <string>
+
+#include "Exceptions/ErrorException.h"
+#include "InputOutput/BinaryResult.h"
+#include "InputOutput/FileUtils.h"
+
+const char Journal::kMagic[4] = { 'S', 'T', 'O', 'J' };
+const uint16_t Journal::kVersion;
+
+// read a whole file, returns false if it cannot be read
+static bool readFile(const FileName& fileName, string* data) {
+  ifstream in(fileName.fullPath().c_str(), ios::binary);
+  if (!in) {
+    return false;
+  }
+  data->assign(std::istreambuf_iterator<char>(in),
+               std::istreambuf_iterator<char>());
+  return !in.bad();
+}
+
+// checksum of the record data following the checksum field
+static uint32_t getChecksum(const char* data, size_t size) {
+  boost::crc_32_type crc;
+  crc.process_bytes(data, size);
+  return crc.checksum();
+}
+
+Journal::Journal(const FileName& fileName, const FileName& snapshotFileName,
+                 size_t dimensions)
+    : fileName(fileName),
+      tempFileName(fileName, fileName.extension + ".tmp"),
+      snapshotFileName(snapshotFileName),
+      dimensions(dimensions),
+      fd(-1),
+      size(0),
+      appended(0),
+      durable(0),
+      writing(false),
+      failed(false) {
+}
+
+Journal::~Journal() {
+  boost::unique_lock<boost::mutex> lock(mutex);
+  drain(&lock);
+  if (fd != -1) {
+    close(fd);
+  }
+}
+
+size_t Journal::open(const Replayer& replay) {
+  boost::unique_lock<boost::mutex> lock(mutex);
+  drain(&lock);
+  if (fd != -1) {
+    close(fd);
+    fd = -1;
+  }
+  failed = false;
+
+  Header header = getHeader(snapshotFileName);
+  string data;
+  bool valid = readFile(fileName, &data) && data.size() >= sizeof(header)
+      && memcmp(data.data(), &header, sizeof(header)) == 0;
+  string tempData;
+  if (!valid && readFile(tempFileName, &tempData)
+      && tempData.size() >= sizeof(header)
+      && memcmp(tempData.data(), &header, sizeof(header)) == 0) {
+    // a checkpoint was interrupted after the snapshot had been renamed
+    LOG(WARNING) << "Completing the checkpoint of '" << fileName.fullPath()
+                 << "'.";
+    if (!FileUtils::rename(tempFileName, fileName)) {
+      fail("cannot rename the new journal");
+    }
+    FileUtils::sync(fileName.path);
+    data.swap(tempData);
+    valid = true;
+  }
+  FileUtils::remove(tempFileName);
+
+  if (!valid) {
+    if (!data.empty()) {
+      LOG(WARNING) << "The journal '" << fileName.fullPath()
+                   << "' does not belong to the cube file, it is renamed to '"
+                   << fileName.extension << ".old'.";
+      FileUtils::rename(fileName, FileName(fileName,
+                                           fileName.extension + ".old"));
+    }
+    data.assign(reinterpret_cast<char*>(&header), sizeof(header));
+    createFile(fileName, data);
+    FileUtils::sync(fileName.path);
+  }
+
+  // replay the records until the first one which is incomplete
+  size_t cellSize = dimensions * sizeof(IdentifierType) + sizeof(double);
+  size_t offset = sizeof(header);
+  size_t records = 0;
+  Cells cells;
+  while (offset + sizeof(RecordHeader) <= data.size()) {
+    RecordHeader record;
+    memcpy(&record, data.data() + offset, sizeof(record));
+    const char* checked = data.data() + offset + 2 * sizeof(uint32_t);
+    size_t end = offset + 2 * sizeof(uint32_t) + record.size;
+    if (record.size != 2 * sizeof(uint32_t) + record.cellCount * cellSize
+        || end > data.size()
+        || getChecksum(checked, record.size) != record.checksum) {
+      break;
+    }
+
+    const char* cell = data.data() + offset + sizeof(record);
+    cells.clear();
+    cells.reserve(record.cellCount);
+    for (uint32_t i = 0; i < record.cellCount; i++) {
+      CellKeyType key(dimensions);
+      memcpy(&key[0], cell, dimensions * sizeof(IdentifierType));
+      cell += dimensions * sizeof(IdentifierType);
+      double value;
+      memcpy(&value, cell, sizeof(value));
+      cell += sizeof(value);
+      cells.push_back(make_pair(key, value));
+    }
+    replay(record.mode, cells);
+    records++;
+    offset = end;
+  }
+
+  if (offset < data.size()) {
+    LOG(WARNING) << "Cutting off " << (data.size() - offset)
+                 << " bytes of an incomplete record of '"
+                 << fileName.fullPath() << "'.";
+    if (truncate(fileName.fullPath().c_str(), offset) != 0) {
+      fail("cannot cut off the incomplete record");
+    }
+  }
+
+  openForAppend();
+  size = offset;
+  return records;
+}
+
+uint64_t Journal::append(uint32_t mode, const Cells& cells) {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  if (failed || fd == -1) {
+    fail("the journal cannot be written");
+  }
+
+  size_t cellSize = dimensions * sizeof(IdentifierType) + sizeof(double);
+  RecordHeader record;
+  record.size = 2 * sizeof(uint32_t) + cells.size() * cellSize;
+  record.checksum = 0;
+  record.mode = mode;
+  record.cellCount = cells.size();
+
+  size_t start = buffer.size();
+  buffer.resize(start + sizeof(record) + cells.size() * cellSize);
+  char* cell = &buffer[start + sizeof(record)];
+  for (auto it = cells.begin(); it != cells.end(); ++it) {
+    memcpy(cell, &it->first[0], dimensions * sizeof(IdentifierType));
+    cell += dimensions * sizeof(IdentifierType);
+    memcpy(cell, &it->second, sizeof(double));
+    cell += sizeof(double);
+  }
+  memcpy(&buffer[start], &record, sizeof(record));
+  record.checksum = getChecksum(&buffer[start + 2 * sizeof(uint32_t)],
+                                record.size);
+  memcpy(&buffer[start], &record, sizeof(record));
+
+  size += sizeof(record) + cells.size() * cellSize;
+  return ++appended;
+}
+
+void Journal::sync(uint64_t sequence) {
+  boost::unique_lock<boost::mutex> lock(mutex);
+  while (durable < sequence) {
+    if (failed) {
+      fail("the journal could not be written");
+    } else if (writing) {
+      written.wait(lock);
+    } else {
+      // the records of the threads waiting meanwhile are written together
+      writeBuffer(&lock);
+    }
+  }
+}
+
+uint64_t Journal::getSize() {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  return size;
+}
+
+uint64_t Journal::getDurableSequence() {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  return durable;
+}
+
+void Journal::checkpoint(uint64_t offset,
+                         const FileName& snapshotTempFileName) {
+  boost::unique_lock<boost::mutex> lock(mutex);
+  drain(&lock);
+  if (failed || fd == -1) {
+    fail("the journal cannot be written");
+  }
+
+  // the records after the offset are not in the snapshot
+  string data;
+  if (!readFile(fileName, &data) || data.size() < offset) {
+    fail("cannot read the journal");
+  }
+  Header header = getHeader(snapshotTempFileName);
+  string journal(reinterpret_cast<char*>(&header), sizeof(header));
+  journal.append(data, offset, string::npos);
+  createFile(tempFileName, journal);
+
+  if (!FileUtils::rename(snapshotTempFileName, snapshotFileName)) {
+    fail("cannot rename the snapshot");
+  }
+
+  // the current journal does not belong to the cube file anymore
+  close(fd);
+  fd = -1;
+  if (!FileUtils::rename(tempFileName, fileName)
+      || !FileUtils::sync(fileName.path)) {
+    failed = true;
+    fail("cannot rename the new journal");
+  }
+  openForAppend();
+  size = journal.size();
+}
+
+Journal::Header Journal::getHeader(const FileName& snapshot) {
+  struct stat info;
+  if (stat(snapshot.fullPath().c_str(), &info) != 0) {
+    fail("cannot read the cube file");
+  }
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(header.magic));
+  header.version = kVersion;
+  header.flags = BinaryResult::getHostFlags();
+  header.dimensions = dimensions;
+  header.snapshotInode = info.st_ino;
+  header.snapshotSize = info.st_size;
+  header.snapshotTime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000
+      + info.st_mtim.tv_nsec;
+  return header;
+}
+
+void Journal::writeBuffer(boost::unique_lock<boost::mutex>* lock) {
+  uint64_t offset = size - buffer.size();
+  string data;
+  data.swap(buffer);
+  uint64_t last = appended;
+  writing = true;
+  lock->unlock();
+
+  bool ok = true;
+  const char* next = data.data();
+  size_t left = data.size();
+  while (ok && left > 0) {
+    ssize_t bytes = write(fd, next, left);
+    if (bytes < 0 && errno != EINTR) {
+      ok = false;
+    } else if (bytes > 0) {
+      next += bytes;
+      left -= bytes;
+    }
+  }
+  ok = ok && fdatasync(fd) == 0;
+  if (!ok) {
+    LOG(ERROR) << "Writing to '" << fileName.fullPath() << "' failed ("
+               << strerror(errno) << ").";
+    // the records were not acknowledged, so they are not replayed either
+    if (ftruncate(fd, offset) != 0) {
+      LOG(ERROR) << "Cutting off the records which were not written to '"
+                 << fileName.fullPath() << "' failed (" << strerror(errno)
+                 << ").";
+    }
+  }
+
+  lock->lock();
+  writing = false;
+  if (ok) {
+    durable = last;
+  } else {
+    // the records appended meanwhile fail as well
+    failed = true;
+    buffer.clear();
+    size = offset;
+  }
+  written.notify_all();
+}
+
+void Journal::drain(boost::unique_lock<boost::mutex>* lock) {
+  while (writing || (!buffer.empty() && !failed)) {
+    if (writing) {
+      written.wait(*lock);
+    } else {
+      writeBuffer(lock);
+    }
+  }
+}
+
+void Journal::createFile(const FileName& file, const string& data) {
+  int fileFd = ::open(file.fullPath().c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                      S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (fileFd == -1) {
+    fail("cannot create '" + file.fullPath() + "'");
+  }
+  bool ok = write(fileFd, data.data(), data.size())
+      == static_cast<ssize_t>(data.size()) && fsync(fileFd) == 0;
+  close(fileFd);
+  if (!ok) {
+    fail("cannot write '" + file.fullPath() + "'");
+  }
+}
+
+void Journal::openForAppend() {
+  fd = ::open(fileName.fullPath().c_str(), O_WRONLY | O_APPEND);
+  if (fd == -1) {
+    failed = true;
+    fail("cannot open the journal");
+  }
+}
+
+void Journal::fail(const string& message) {
+  LOG(ERROR) << "Journal '" << fileName.fullPath() << "': " << message
+             << ".";
+  throw ErrorException(ErrorException::ERROR_INTERNAL,
+                       message + " (" + fileName.fullPath() + ")");
+}
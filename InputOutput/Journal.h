@@ -0,0 +1,154 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#ifndef STOAP_INPUTOUTPUT_JOURNAL_H_
+#define STOAP_INPUTOUTPUT_JOURNAL_H_ 1
+
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <string>
+#include <vector>
+
+#include "Olap.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief append-only journal of the cells written to a cube
+///
+/// The journal belongs to a snapshot, the cube file. It starts with a Header
+/// which identifies the snapshot by its inode, size and modification time, so
+/// a journal is never replayed on top of a cube file which was replaced. A
+/// record is written for every batch of cells: a RecordHeader with the size
+/// and CRC-32 of the record, followed by one identifier per dimension and the
+/// value of every cell. A record which was not written completely is cut off
+/// when the journal is opened.
+///
+/// Records are appended to a buffer and written by the first thread which
+/// waits for one of them with sync(). It writes all buffered records and
+/// flushes them to the disk with one fdatasync(), while the other threads
+/// wait for it (group commit).
+////////////////////////////////////////////////////////////////////////////////
+
+class Journal {
+ public:
+  struct Header {
+    char magic[4];
+    uint16_t version;
+    uint16_t flags;
+    uint32_t dimensions;
+    uint32_t reserved;
+    uint64_t snapshotInode;
+    uint64_t snapshotSize;
+    int64_t snapshotTime;  // modification time in nanoseconds
+  };
+
+  struct RecordHeader {
+    uint32_t size;  // bytes following the checksum
+    uint32_t checksum;
+    uint32_t mode;
+    uint32_t cellCount;
+  };
+
+  typedef vector<pair<CellKeyType, double> > Cells;
+  typedef boost::function<void(uint32_t mode, const Cells& cells)> Replayer;
+
+  static const char kMagic[4];
+  static const uint16_t kVersion = 1;
+
+  Journal(const FileName& fileName, const FileName& snapshotFileName,
+          size_t dimensions);
+
+  ~Journal();
+
+  // pass the records written since the snapshot to replay and open the
+  // journal for appending. A journal of another snapshot is renamed to
+  // '.journal.old' and a new one is started. Throws an ErrorException if the
+  // journal cannot be read or written.
+  size_t open(const Replayer& replay);
+
+  // buffer a record and return its sequence number. The record is written
+  // by sync(). Throws an ErrorException if the journal cannot be written.
+  uint64_t append(uint32_t mode, const Cells& cells);
+
+  // wait until the record with the sequence number is on the disk. Throws
+  // an ErrorException if it could not be written. A failed write is cut off
+  // the journal, and the records buffered meanwhile are dropped, until the
+  // journal is opened again.
+  void sync(uint64_t sequence);
+
+  // sequence number of the last record on the disk
+  uint64_t getDurableSequence();
+
+  // bytes of the journal including the buffered records
+  uint64_t getSize();
+
+  // start a new journal for the snapshot written to snapshotTempFileName,
+  // which holds the records before offset, and rename the snapshot to the
+  // cube file. If the server stops after the snapshot was renamed, open()
+  // finds the new journal next to the old one.
+  void checkpoint(uint64_t offset, const FileName& snapshotTempFileName);
+
+ private:
+  Journal(const Journal&);
+  Journal& operator=(const Journal&);
+
+  // the header of a journal for the snapshot file
+  Header getHeader(const FileName& snapshot);
+
+  // write the buffered records, the mutex must be held and no other thread
+  // may be writing
+  void writeBuffer(boost::unique_lock<boost::mutex>* lock);
+
+  // wait for the writing thread and write the buffered records
+  void drain(boost::unique_lock<boost::mutex>* lock);
+
+  // create a file holding the data and flush it to the disk
+  void createFile(const FileName& file, const string& data);
+
+  // open the journal for appending
+  void openForAppend();
+
+  // throw an ErrorException for the failed operation
+  void fail(const string& message);
+
+  FileName fileName;
+  FileName tempFileName;
+  FileName snapshotFileName;
+  size_t dimensions;
+
+  boost::mutex mutex;
+  boost::condition_variable written;
+  int fd;
+  string buffer;
+  uint64_t size;  // bytes of the journal and the buffer
+  uint64_t appended;  // sequence number of the last buffered record
+  uint64_t durable;  // sequence number of the last record on the disk
+  bool writing;
+  bool failed;
+};
+
+#endif  // STOAP_INPUTOUTPUT_JOURNAL_H_
@@ -0,0 +1,131 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#include "InputOutput/ResultWriter.h"
+
+#include <assert.h>
+#include <string.h>
+
+const size_t ResultWriter::kChunkSize;
+
+ResultWriter::ResultWriter(ostream* out)
+    : out(out) {
+  buffer.reserve(kChunkSize);
+}
+
+ResultWriter::~ResultWriter() {
+}
+
+void ResultWriter::finish() {
+  flush();
+}
+
+void ResultWriter::flush() {
+  out->write(buffer.begin(), buffer.length());
+  out->flush();
+  buffer.clear();
+}
+
+TextResultWriter::TextResultWriter(ostream* out, bool addPath, bool addZero)
+    : ResultWriter(out),
+      addPath(addPath),
+      addZero(addZero) {
+}
+
+void TextResultWriter::add(const CellKeyType* paths, double* const* values,
+                           size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    buffer.appendText("1;", 2);  // cell type (numeric)
+    if (values[i] == NULL) {
+      buffer.appendText("0;;", 3);  // not found
+    } else {
+      buffer.appendText("1;", 2);  // found + value
+      buffer.appendDecimal(*values[i]);
+      buffer.appendChar(';');
+    }
+
+    if (addPath) {  // path
+      for (size_t dim = 0; dim < paths[i].size(); dim++) {
+        if (dim > 0) {
+          buffer.appendChar(',');
+        }
+        buffer.appendInteger(paths[i][dim]);
+      }
+      buffer.appendChar(';');
+    }
+    if (addZero) buffer.appendText(";0;", 3);  // zero
+    buffer.appendEol();
+  }
+  flushChunk();
+}
+
+BinaryResultWriter::BinaryResultWriter(ostream* out, uint64_t cellCount)
+    : ResultWriter(out),
+      cellCount(cellCount),
+      numCells(0),
+      bitmap(0),
+      blockSize(0) {
+  BinaryResult::Header header;
+  memcpy(header.magic, BinaryResult::kMagic, sizeof(header.magic));
+  header.version = BinaryResult::kVersion;
+  header.flags = BinaryResult::getHostFlags();
+  header.cellCount = cellCount;
+  buffer.appendData(&header, sizeof(header));
+}
+
+void BinaryResultWriter::add(const CellKeyType* paths, double* const* values,
+                             size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (values[i] == NULL) {
+      this->values[blockSize] = 0.0;
+    } else {
+      bitmap |= uint64_t(1) << blockSize;
+      this->values[blockSize] = *values[i];
+    }
+    if (++blockSize == BinaryResult::kBlockCells) {
+      appendBlock();
+    }
+  }
+  numCells += count;
+  flushChunk();
+}
+
+void BinaryResultWriter::finish() {
+  assert(numCells == cellCount);
+  if (blockSize > 0) {
+    appendBlock();
+  }
+  ResultWriter::finish();
+}
+
+void BinaryResultWriter::appendBlock() {
+  buffer.appendData(&bitmap, sizeof(bitmap));
+  buffer.appendData(values, blockSize * sizeof(double));
+  bitmap = 0;
+  blockSize = 0;
+}
@@ -0,0 +1,111 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#ifndef STOAP_INPUTOUTPUT_RESULTWRITER_H_
+#define STOAP_INPUTOUTPUT_RESULTWRITER_H_ 1
+
+#include "Olap.h"
+#include "Collections/StringBuffer.h"
+#include "InputOutput/BinaryResult.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief writes the cell values of an answer to an output stream
+///
+/// The cells are added in batches together with their paths, a NULL value
+/// means that the cell was not found. The output is collected in a buffer
+/// and written to the stream in chunks of about kChunkSize bytes, so the
+/// memory needed for an answer does not depend on its size.
+////////////////////////////////////////////////////////////////////////////////
+
+class ResultWriter {
+ public:
+  static const size_t kChunkSize = 1 << 16;
+
+  explicit ResultWriter(ostream* out);
+  virtual ~ResultWriter();
+
+  // append the cells of a batch
+  virtual void add(const CellKeyType* paths, double* const* values,
+                   size_t count) = 0;
+
+  // write the remaining output to the stream
+  virtual void finish();
+
+ protected:
+  // write the buffer to the stream once it holds a full chunk
+  void flushChunk() {
+    if (buffer.length() >= kChunkSize) {
+      flush();
+    }
+  }
+
+  void flush();
+
+  ostream* out;
+  StringBuffer buffer;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief writes the text answer "1;<found>;<value>;<path>;;0;" per cell
+////////////////////////////////////////////////////////////////////////////////
+
+class TextResultWriter : public ResultWriter {
+ public:
+  TextResultWriter(ostream* out, bool addPath, bool addZero);
+
+  void add(const CellKeyType* paths, double* const* values, size_t count);
+
+ private:
+  bool addPath;
+  bool addZero;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief writes the binary answer described by BinaryResult
+///
+/// Exactly cellCount cells have to be added before finish is called.
+////////////////////////////////////////////////////////////////////////////////
+
+class BinaryResultWriter : public ResultWriter {
+ public:
+  BinaryResultWriter(ostream* out, uint64_t cellCount);
+
+  void add(const CellKeyType* paths, double* const* values, size_t count);
+  void finish();
+
+ private:
+  void appendBlock();
+
+  uint64_t cellCount;
+  uint64_t numCells;
+  uint64_t bitmap;
+  double values[BinaryResult::kBlockCells];
+  size_t blockSize;
+};
+
+#endif  // STOAP_INPUTOUTPUT_RESULTWRITER_H_
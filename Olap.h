@@ -48,6 +48,7 @@
 
 #include <algorithm>
 #include <deque>
+#include <fstream>
 #include <map>
 #include <unordered_map>
 #include <queue>
@@ -62,6 +63,8 @@
 #include <iomanip>
 #include <iterator>
 
+#include "Collections/FixedVector.h"
+
 using std::string;
 using std::vector;
 using std::endl;
@@ -76,7 +79,9 @@ using std::streamsize;
 using std::streampos;
 using std::stringstream;
 using std::ostream;
+using std::istream;
 using std::ofstream;
+using std::ifstream;
 using std::set;
 using std::map;
 using std::deque;
@@ -168,6 +173,18 @@ typedef vector<Element*> ElementsType;
 
 typedef vector<IdentifierType> IdentifiersType;
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief maximal number of dimensions of a cube
+////////////////////////////////////////////////////////////////////////////////
+
+#define MAX_DIMENSIONS 16
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief cell path, one identifier per dimension stored in place
+////////////////////////////////////////////////////////////////////////////////
+
+typedef FixedVector<IdentifierType, MAX_DIMENSIONS> CellKeyType;
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief type for one element and weight
 ////////////////////////////////////////////////////////////////////////////////
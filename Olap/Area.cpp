@@ -55,7 +55,7 @@ Area::PathIterator::PathIterator(const Area &area, bool end,
 }
 
 Area::PathIterator::PathIterator(const Area &area, bool end,
-                                 const IdentifiersType &path)
+                                 const CellKeyType &path)
     : ids(path),
       end(end),
       area(&area),
@@ -87,7 +87,7 @@ Area::PathIterator &Area::PathIterator::operator++() {
   return *this;
 }
 
-const IdentifiersType &Area::PathIterator::operator*() const {
+const CellKeyType &Area::PathIterator::operator*() const {
   return ids;
 }
 
@@ -108,7 +108,7 @@ bool Area::PathIterator::operator==(const PathIterator &it) const {
           }
         }
       } else {
-        const IdentifiersType &p1 = singlePath ? ids : it.ids;
+        const CellKeyType &p1 = singlePath ? ids : it.ids;
         const vector<ConstElemIter> &p2 = singlePath ? it.path : path;
         for (size_t i = 0; i < p1.size(); i++) {
           if (p1[i] != *p2[i]) {
@@ -137,7 +137,7 @@ Area::Area(const Area &area)
       stepSizes(area.stepSizes) {
 }
 
-Area::Area(const IdentifiersType &path, bool useSet)
+Area::Area(const CellKeyType &path, bool useSet)
     : area(useSet ? path.size() : 0),
       areaSize(1),
       stepSizes(path.size(), 0) {
@@ -164,9 +164,8 @@ Area::Area(const vector<IdentifiersType> &idsArea)
     if (idsArea[i].size() == 1 && idsArea[i][0] == ALL_IDENTIFIERS ) {
       s = new Set(true);
     } else {
-      for (size_t j = 0; j < idsArea[i].size(); j++) {
-        s->insert(idsArea[i][j]);
-      }
+      s->insert(idsArea[i].begin(), idsArea[i].end());
+      s->optimize();
     }
     insert((IdentifierType) i, s, false);
   }
@@ -219,7 +218,7 @@ void Area::insert(size_t dimOrdinal, const Set* elems, bool calc) {
   }
 }
 
-Area::PathIterator Area::find(const IdentifiersType &path) const {
+Area::PathIterator Area::find(const CellKeyType &path) const {
   if (path.size() != area.size()) {
     return pathEnd();
   }
@@ -238,7 +237,7 @@ Area::PathIterator Area::find(const IdentifiersType &path) const {
   }
 }
 
-bool Area::isInArea(const IdentifiersType* path) const {
+bool Area::isInArea(const CellKeyType* path) const {
   if (path->size() != area.size()) {
     return false;
   }
@@ -289,7 +288,10 @@ Area* Area::intersect(const CubeArea &area) const {
   vector<IdentifiersType> resultPaths;
   for(auto selfIt = this->pathBegin(); selfIt != this->pathEnd(); ++selfIt) {
     for(auto areaIt = area.pathBegin(); areaIt != area.pathEnd(); ++areaIt) {
-      if (*selfIt == *areaIt) resultPaths.push_back(*selfIt);
+      if (*selfIt == *areaIt) {
+        const CellKeyType &path = *selfIt;
+        resultPaths.push_back(IdentifiersType(path.begin(), path.end()));
+      }
     }
   }
 
@@ -337,7 +339,7 @@ CubeArea::CubeArea(const AggrEnv* env, Cube* cube,
       env(env),
       cube(cube) {
 }
-CubeArea::CubeArea(const AggrEnv* env, Cube* cube, const IdentifiersType &path,
+CubeArea::CubeArea(const AggrEnv* env, Cube* cube, const CellKeyType &path,
                    bool useSet)
     : Area(path, useSet),
       env(env),
@@ -385,11 +387,7 @@ CubeArea* CubeArea::expandBase(AggregationMaps *aggregationMaps) const {
       try {
         const WeightedSet* baseE = dimension->getBaseElements(element);
         for (auto baseIt = baseE->begin(); baseIt != baseE->end(); ++baseIt) {
-          // it seems there is a bug in Set::insert which adds the same id multiple times.
-          // therefore check if the element already exists
-          if (s->find(baseIt.first()) == s->end()) {
-            s->insert(baseIt.first());
-          }
+          s->insert(baseIt.first());
         }
         /*
         DLOG(WARNING) << "CubeArea::expandBase adding " << baseE->size()
@@ -400,6 +398,7 @@ CubeArea* CubeArea::expandBase(AggregationMaps *aggregationMaps) const {
         // LOG(ERROR) << "CubeArea::expandBase exception: " << e.getMessage();
       }
     }
+    s->optimize();
     result->insert(dim, s);
     aggregationMaps->at(dim).compactSourceToTarget();
   }
@@ -473,8 +472,8 @@ ostream& operator<<(ostream& ostr, const Area &cubeArea) {
 }
 
 ostream& operator<<(ostream& ostr, const Set &set) {
-  for (std::set<std::pair<IdentifierType, IdentifierType> >::iterator range =
-      set.ranges.begin(); range != set.ranges.end(); ++range) {
+  for (Set::SetType::const_iterator range = set.ranges.begin();
+      range != set.ranges.end(); ++range) {
     if (range != set.ranges.begin()) {
       ostr << ',';
     }
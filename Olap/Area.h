@@ -51,14 +51,14 @@ class Area {
   class PathIterator {
    public:
     PathIterator(const Area &area, bool end, const vector<ConstElemIter> &path);
-    PathIterator(const Area &area, bool end, const IdentifiersType &path);
+    PathIterator(const Area &area, bool end, const CellKeyType &path);
     PathIterator();
     PathIterator(const PathIterator &it);
     PathIterator &operator++();
-    const IdentifiersType &operator*() const;
+    const CellKeyType &operator*() const;
     bool operator==(const PathIterator &it) const;
     bool operator!=(const PathIterator &it) const;
-    bool operator!=(const IdentifiersType &key) const;
+    bool operator!=(const CellKeyType &key) const;
     PathIterator operator+(double count) const;
     double operator-(const PathIterator &it) const;
     string toString() const;
@@ -66,7 +66,7 @@ class Area {
    private:
     double getPosition() const;
     vector<ConstElemIter> path;
-    IdentifiersType ids;
+    CellKeyType ids;
     bool end;
     const Area *area;
     bool singlePath;
@@ -74,7 +74,7 @@ class Area {
 
   explicit Area(size_t dimCount);
   Area(const Area &area);
-  Area(const IdentifiersType &path, bool useSet);
+  Area(const CellKeyType &path, bool useSet);
   explicit Area(const vector<IdentifiersType> &area);
 
   ConstElemIter elemBegin(size_t dimOrdinal) const;
@@ -85,9 +85,9 @@ class Area {
   PathIterator getIterator(const Area* path) const;
 
   void insert(size_t dimOrdinal, const Set* elems, bool calc = true);
-  PathIterator find(const IdentifiersType &path) const;
-  bool isInArea(const IdentifiersType* path) const;
-  PathIterator lowerBound(const IdentifiersType &path) const;
+  PathIterator find(const CellKeyType &path) const;
+  bool isInArea(const CellKeyType* path) const;
+  PathIterator lowerBound(const CellKeyType &path) const;
   size_t dimCount() const;
   size_t elemCount(size_t dimOrdinal) const;
   size_t elemMax(size_t dimOrdinal) const;
@@ -110,7 +110,7 @@ class Area {
   vector<double> stepSizes;
 
  protected:
-  IdentifiersType vpath;  //single cell
+  CellKeyType vpath;  //single cell
   bool isSingleCell() const {
     return !vpath.empty();
   }
@@ -142,7 +142,7 @@ class CubeArea : public Area {
   CubeArea(const AggrEnv* env, Cube* cube, size_t dimCount);
   CubeArea(const AggrEnv* env, Cube* cube, const Area &area);
   CubeArea(const AggrEnv* env, Cube* cube,
-           const IdentifiersType &path, bool useSet = true);
+           const CellKeyType &path, bool useSet = true);
   CubeArea(const AggrEnv* env, Cube* cube,
            const vector<IdentifiersType> &area);
   /*
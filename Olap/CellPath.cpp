@@ -32,19 +32,15 @@
 #include <string>
 #include <vector>
 
-#include "Stoap/AggregationEnvironment.h"
-#include "Olap/Cube.h"
 #include "Olap/Dimension.h"
 #include "Collections/StringBuffer.h"
 #include "Exceptions/ErrorException.h"
 
 // The CellPath constructor is called quite often, so it has to be as fast as possible.
-CellPath::CellPath(const IdentifiersType* identifiers)
+CellPath::CellPath(const CellKeyType* identifiers,
+                   const vector<Dimension*>* dimensions)
     : pathIdentifiers(identifiers),
       base(true) {
-
-  const vector<Dimension*>* dimensions = AggrEnv::instance().getCube()->getDimensions();
-
   // the number of dimensions has to match the number of identifiers in the given path
   if (identifiers->size() != dimensions->size()) {
     std::ostringstream stringStream;
@@ -55,7 +51,7 @@ CellPath::CellPath(const IdentifiersType* identifiers)
   }
 
   // convert identifiers into elements
-  IdentifiersType::const_iterator identifiersIter = identifiers->begin();
+  CellKeyType::const_iterator identifiersIter = identifiers->begin();
   vector<Dimension*>::const_iterator dimensionIter = dimensions->begin();
   // PathType::iterator pathIter = pathElements.begin();
 
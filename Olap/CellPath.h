@@ -52,11 +52,12 @@ class CellPath {
   /// @throws ParameterException on double or missing dimensions
   ///
   /// The object constructor verifies the elements and computes the path type.
-  /// If the list of elements is not a suitable cell path for the given cube
-  /// the constructor throws a ParameterException.
+  /// If the list of elements is not a suitable cell path for the dimensions
+  /// of the cube the constructor throws a ParameterException.
   ////////////////////////////////////////////////////////////////////////////////
 
-  CellPath(const IdentifiersType* identifiers);
+  CellPath(const CellKeyType* identifiers,
+           const vector<Dimension*>* dimensions);
 
  public:
   ////////////////////////////////////////////////////////////////////////////////
@@ -79,7 +80,7 @@ class CellPath {
   /// @brief get identifiers of path elements
   ////////////////////////////////////////////////////////////////////////////////
 
-  const IdentifiersType* getPathIdentifier() const {
+  const CellKeyType* getPathIdentifier() const {
     return pathIdentifiers;
   }
 
@@ -108,7 +109,7 @@ class CellPath {
   /// @brief list of identifiers (identifiers of the elements)
   ////////////////////////////////////////////////////////////////////////////////
 
-  const IdentifiersType* pathIdentifiers;
+  const CellKeyType* pathIdentifiers;
 
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief true if path contains only base elements
@@ -0,0 +1,100 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#include "Olap/ColumnStorage.h"
+
+#include <boost/thread/locks.hpp>
+#include <vector>
+
+ColumnStorage::ColumnStorage(const DoubleStorage* storage, size_t dimCount)
+    : columns(dimCount),
+      maxIdentifiers(dimCount, 0) {
+  for (size_t d = 0; d < dimCount; d++) {
+    columns[d].reserve(storage->m.size());
+  }
+  values.reserve(storage->m.size());
+
+  for (auto it = storage->m.begin(); it != storage->m.end(); ++it) {
+    const CellKeyType &key = it->first;
+    for (size_t d = 0; d < dimCount; d++) {
+      columns[d].push_back(key[d]);
+      maxIdentifiers[d] = max(maxIdentifiers[d], key[d]);
+    }
+    values.push_back(it->second);
+  }
+}
+
+bool ColumnStorage::findRow(const CellKeyType* key, size_t* row) const {
+  boost::lock_guard<boost::mutex> lock(rowIndexMutex);
+  if (rowIndex.empty()) {
+    buildRowIndex();
+  }
+
+  const size_t mask = rowIndex.size() - 1;
+  for (size_t slot = mapops()(*key) & mask; rowIndex[slot] != 0;
+      slot = (slot + 1) & mask) {
+    size_t candidate = rowIndex[slot] - 1;
+    size_t d = 0;
+    while (d < columns.size() && columns[d][candidate] == (*key)[d]) {
+      d++;
+    }
+    if (d == columns.size()) {
+      *row = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ColumnStorage::buildRowIndex() const {
+  // at most half of the slots are used, so the probe sequences stay short
+  size_t slots = 2;
+  while (slots < 2 * size()) {
+    slots *= 2;
+  }
+  rowIndex.assign(slots, 0);
+
+  CellKeyType key;
+  for (size_t row = 0; row < size(); row++) {
+    getKey(row, &key);
+    size_t slot = mapops()(key) & (slots - 1);
+    while (rowIndex[slot] != 0) {
+      slot = (slot + 1) & (slots - 1);
+    }
+    rowIndex[slot] = row + 1;
+  }
+}
+
+size_t ColumnStorage::getMemoryUsage() const {
+  boost::lock_guard<boost::mutex> lock(rowIndexMutex);
+  size_t bytes = values.capacity() * sizeof(double)
+      + rowIndex.capacity() * sizeof(uint32_t);
+  for (auto it = columns.begin(); it != columns.end(); ++it) {
+    bytes += it->capacity() * sizeof(IdentifierType);
+  }
+  return bytes;
+}
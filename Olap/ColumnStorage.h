@@ -0,0 +1,106 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#ifndef STOAP_OLAP_COLUMNSTORAGE_H_
+#define STOAP_OLAP_COLUMNSTORAGE_H_ 1
+
+#include <boost/thread/mutex.hpp>
+#include <vector>
+
+#include "Olap.h"
+#include "Olap/DoubleStorage.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief read-optimized copy of a cell storage
+///
+/// Holds one contiguous identifier column per dimension and a value column.
+/// The cells are stored in the iteration order of the DoubleStorage they
+/// were copied from, so scanning the columns visits the cells in the same
+/// order as iterating the hash map.
+///
+/// The row of a cell is found with an index of the rows by the hash of their
+/// keys, which is built on the first lookup: only cubes with written cells
+/// need it.
+////////////////////////////////////////////////////////////////////////////////
+
+class ColumnStorage {
+ public:
+  ColumnStorage(const DoubleStorage* storage, size_t dimCount);
+
+  size_t size() const {
+    return values.size();
+  }
+
+  size_t dimCount() const {
+    return columns.size();
+  }
+
+  const IdentifierType* getColumn(size_t dimOrdinal) const {
+    return columns[dimOrdinal].data();
+  }
+
+  // largest identifier stored in the column
+  IdentifierType getMaxIdentifier(size_t dimOrdinal) const {
+    return maxIdentifiers[dimOrdinal];
+  }
+
+  const double* getValues() const {
+    return values.data();
+  }
+
+  // copy the identifiers of a row into key
+  void getKey(size_t row, CellKeyType* key) const {
+    key->clear();
+    for (size_t d = 0; d < columns.size(); d++) {
+      key->push_back(columns[d][row]);
+    }
+  }
+
+  // find the row of the cell with the identifiers of key, returns false if
+  // the cell is not stored
+  bool findRow(const CellKeyType* key, size_t* row) const;
+
+  size_t getMemoryUsage() const;
+
+ private:
+  ColumnStorage(const ColumnStorage&);
+  ColumnStorage& operator=(const ColumnStorage&);
+
+  // fill the index of the rows, rowIndexMutex has to be held
+  void buildRowIndex() const;
+
+  vector<IdentifiersType> columns;
+  IdentifiersType maxIdentifiers;
+  vector<double> values;
+
+  // open addressing table of the rows + 1 by the hash of their keys, 0 for
+  // an empty slot
+  mutable boost::mutex rowIndexMutex;
+  mutable vector<uint32_t> rowIndex;
+};
+
+#endif  // STOAP_OLAP_COLUMNSTORAGE_H_
@@ -29,6 +29,7 @@
 
 #include "Olap/Cube.h"
 
+#include <boost/scoped_ptr.hpp>
 #include <algorithm>
 #include <string>
 #include <vector>
@@ -43,14 +44,24 @@ Cube::Cube(const string& cubeName, const FileName& cubeFileName,
     throw ParameterException(ErrorException::ERROR_CUBE_EMPTY,
                              "missing dimensions", "dimensions", "");
   }
+  if (_dimensions.size() > MAX_DIMENSIONS) {
+    throw ParameterException(ErrorException::ERROR_INVALID_COORDINATES,
+                             "too many dimensions", "dimensions", "");
+  }
 
   dataLines = 0;
-  storage = new DoubleStorage();
+  loaded = false;
+  columnar = true;
+  loadTime = 0;
+  fileTime = 0;
+  storage.reset(new DoubleStorage());
+  numChanged = 0;
+  numHidden = 0;
   filledCellArea = new Area(0);
 }
 
 Cube::~Cube() {
-  delete storage;
+  clearChanges();
 
   if (fileName != 0) {
     delete fileName;
@@ -58,6 +69,7 @@ Cube::~Cube() {
 }
 
 void Cube::loadCube() {
+  cpu_timer timer;
   if (fileName == 0) {
     throw ErrorException(ErrorException::ERROR_INTERNAL,
                          "cube file name not set");
@@ -72,10 +84,12 @@ void Cube::loadCube() {
   }
 
   FileName fn(*fileName, "csv");
+  fileTime = FileUtils::getModificationTime(fn);
   dataLines = getFileLines(fn.fullPath().c_str());
   LOG(INFO) << "There are approximately " << dataLines << " values to load.";
 
   // prepare the storage container
+  clearChanges();
   // storage->m.clear();
   // storage->m.min_load_factor(0.9);
   // storage->m.max_load_factor(1.0);
@@ -115,6 +129,22 @@ void Cube::loadCube() {
   }
 
   delete file;
+
+  loadTime = timer.elapsed().wall / 1e9;
+  loaded = true;
+}
+
+void Cube::unloadCube() {
+  storage.reset(new DoubleStorage());
+  columns.reset();
+  clearChanges();
+  loaded = false;
+}
+
+void Cube::clearChanges() {
+  deltas.clear();
+  numChanged = 0;
+  numHidden = 0;
 }
 
 size_t Cube::getFileLines(const char *file) {
@@ -153,29 +183,10 @@ void Cube::loadCubeCells(FileReader* file) {
         throw FileFormatException("error in numeric cell path", file);
       }
 
-      bool failed = false;
-      for (size_t i = 0; i < size; i++) {
-        Element *elem = _dimensions[i]->lookupElement(ids[i]);
-        if (!elem || elem->getElementType() == CONSOLIDATED) {
-          if (!elem) {
-            DLOG(INFO)<< "error in numeric cell path of cube '" << name
-            << "', skipping entry " << ids[i] << " in dimension '"
-            << _dimensions[i]->getName() << "'.";
-          } else {
-            DLOG(INFO) << "consolidation in numeric cell path of cube '"
-            << name << "', skipping entry " << ids[i]
-            << " in dimension '" << _dimensions[i]->getName()
-            << "'.";
-          }
-
-          failed = true;
-          break;
-        }
-      }
-
-      if (!failed) {
+      if (isBasePath(ids)) {
         // filledSources.push_back(ids);
-        storage->setValue(&ids, d);
+        CellKeyType key(ids.begin(), ids.end());
+        storage->setValue(&key, d);
       }
 
       file->nextLine();
@@ -190,6 +201,13 @@ void Cube::loadCubeCells(FileReader* file) {
   // attempt to free some memory
   storage->m.resize(0);
 
+  // copy the cells into columns for the aggregation scans
+  if (columnar) {
+    columns.reset(new ColumnStorage(storage.get(), size));
+    LOG(INFO) << "Column storage uses " << columns->getMemoryUsage()
+              << " bytes.";
+  }
+
   // Don't attempt to load the string section, if it exists.
   /*
    if (file->isSectionLine() && file->getSection() == "STRING") {
@@ -205,8 +223,315 @@ void Cube::loadCubeCells(FileReader* file) {
    */
 }
 
+bool Cube::isBasePath(const IdentifiersType& ids) const {
+  for (size_t i = 0; i < ids.size(); i++) {
+    Element *elem = _dimensions[i]->lookupElement(ids[i]);
+    if (!elem || elem->getElementType() == CONSOLIDATED) {
+      if (!elem) {
+        DLOG(INFO)<< "error in numeric cell path of cube '" << name
+        << "', skipping entry " << ids[i] << " in dimension '"
+        << _dimensions[i]->getName() << "'.";
+      } else {
+        DLOG(INFO) << "consolidation in numeric cell path of cube '"
+        << name << "', skipping entry " << ids[i]
+        << " in dimension '" << _dimensions[i]->getName()
+        << "'.";
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+void Cube::loadCube(const Cube& version) {
+  cpu_timer timer;
+  // the base storage and the delta segments are shared
+  storage = version.storage;
+  columns = version.columns;
+  columnar = version.columnar;
+  deltas = version.deltas;
+  numChanged = version.numChanged;
+  numHidden = version.numHidden;
+  dimensionsSize = version.dimensionsSize;
+  dataLines = version.dataLines;
+  fileTime = version.fileTime;
+
+  loadTime = timer.elapsed().wall / 1e9;
+  loaded = true;
+}
+
+void Cube::saveCube(IdentifierType identifier, const FileName& cubeFileName,
+                    const boost::function<void(size_t)>& progress) {
+  boost::scoped_ptr<FileWriter> file(FileWriter::getFileWriter(cubeFileName));
+  file->openFile();
+
+  file->appendComment("PALO CUBE DATA");
+  file->appendComment("");
+  file->appendSection("CUBE");
+  file->appendIdentifier(identifier);
+  file->appendIdentifiers(dimensionsSize.begin(), dimensionsSize.end());
+  file->nextLine();
+
+  // the base cells which are not hidden by the changes, then the changes
+  file->appendSection("NUMERIC");
+  size_t written = 0;
+  for (auto it = storage->m.begin(); it != storage->m.end(); ++it) {
+    if (getValue(&it->first) == &it->second) {
+      file->appendIdentifiers(it->first.begin(), it->first.end());
+      file->appendDouble(it->second);
+      file->nextLine();
+      if (++written % kProgressCells == 0 && progress) {
+        progress(written);
+      }
+    }
+  }
+  for (size_t i = 0; i < deltas.size(); i++) {
+    const DoubleStorage& cells = deltas[i]->getCells();
+    for (auto it = cells.m.begin(); it != cells.m.end(); ++it) {
+      if (isReplaced(i, &it->first)) {
+        continue;
+      }
+      file->appendIdentifiers(it->first.begin(), it->first.end());
+      file->appendDouble(it->second);
+      file->nextLine();
+      if (++written % kProgressCells == 0 && progress) {
+        progress(written);
+      }
+    }
+  }
+  file->appendSection("STRING");
+  file->closeFile();
+  if (progress) {
+    progress(written);
+  }
+
+  if (!FileUtils::sync(cubeFileName.fullPath())) {
+    throw FileOpenException("could not write file", cubeFileName.fullPath());
+  }
+}
+
+void Cube::readDelta(const FileName& deltaFileName, DeltaMode mode,
+                     vector<pair<CellKeyType, double> >* cells) const {
+  size_t size = _dimensions.size();
+  boost::scoped_ptr<FileReader> file(FileReader::getFileReader(deltaFileName));
+  file->openFile(true, false);
+
+  // the size section of a cube file is not needed
+  if (file->isSectionLine() && file->getSection() == "CUBE") {
+    file->nextLine();
+    while (file->isDataLine()) {
+      file->nextLine();
+    }
+  }
+  if (!file->isSectionLine() || file->getSection() != "NUMERIC") {
+    throw FileFormatException("section 'NUMERIC' not found", file.get());
+  }
+
+  // all cells are read first, so a corrupted file does not change the cube
+  file->nextLine();
+  while (file->isDataLine()) {
+    IdentifiersType ids = file->getDataIdentifiers(0);
+    if (size != ids.size()) {
+      LOG(ERROR) << "error in numeric cell path of delta for cube '" << name
+                 << "'";
+      throw FileFormatException("error in numeric cell path", file.get());
+    }
+    if (isBasePath(ids)) {
+      double value = mode == DELTA_CLEAR ? 0 : file->getDataDouble(1);
+      cells->push_back(make_pair(CellKeyType(ids.begin(), ids.end()),
+                                 value));
+    }
+    file->nextLine();
+  }
+}
+
+Cube::DeltaCounts Cube::applyCells(
+    const vector<pair<CellKeyType, double> >& cells, DeltaMode mode) {
+  // the batch is collected in a new segment, the current ones are not changed
+  boost::shared_ptr<DeltaSegment> delta(new DeltaSegment());
+  DeltaCounts counts;
+  if (mode != DELTA_CLEAR) {
+    delta->reserve(cells.size());
+  }
+
+  for (auto it = cells.begin(); it != cells.end(); ++it) {
+    const CellKeyType* key = &it->first;
+    // changed is false as long as the base cell is not replaced or removed
+    bool changed = delta->contains(key);
+    double* value = changed ? delta->getValue(key) : getChange(key, &changed);
+    double* base = changed ? NULL : storage->getValue(key);
+
+    if (mode == DELTA_CLEAR) {
+      if (value != NULL) {
+        delta->clearValue(key);
+        numChanged--;
+        counts.removed++;
+      } else if (base != NULL) {
+        delta->clearValue(key);
+        hideBaseCell(key, delta.get());
+        counts.removed++;
+      }
+      continue;
+    }
+
+    double* current = changed ? value : base;
+    if (current == NULL) {
+      delta->setValue(key, it->second);
+      numChanged++;
+      counts.inserted++;
+    } else {
+      double newValue = mode == DELTA_ADD ? *current + it->second
+                                          : it->second;
+      if (base != NULL) {
+        hideBaseCell(key, delta.get());
+        numChanged++;
+      }
+      delta->setValue(key, newValue);
+      counts.updated++;
+    }
+  }
+
+  if (delta->size() > 0) {
+    addDelta(delta);
+  }
+  return counts;
+}
+
+void Cube::hideBaseCell(const CellKeyType* key, DeltaSegment* delta) {
+  // the scans of the column storage skip the rows of the hidden cells, the
+  // scans of the hash map look up whether a base cell is hidden
+  size_t row;
+  if (columns && columns->findRow(key, &row)) {
+    delta->hideBaseCell(row);
+  } else {
+    delta->hideBaseCell();
+  }
+  numHidden++;
+}
+
+void Cube::addDelta(const boost::shared_ptr<DeltaSegment>& delta) {
+  // a segment is merged with the one below unless that one is more than
+  // twice as large, so the sizes of the segments at least double from the
+  // newest to the oldest. A cube has about log2 of its changes segments and
+  // a changed cell is copied by about as many merges.
+  boost::shared_ptr<DeltaSegment> top = delta;
+  while (!deltas.empty() && deltas.back()->size() <= 2 * top->size()) {
+    top.reset(new DeltaSegment(*deltas.back(), *top, _dimensions.size()));
+    deltas.pop_back();
+  }
+  if (top == delta) {
+    delta->publish(_dimensions.size());
+  }
+  deltas.push_back(top);
+}
+
+double* Cube::getChange(const CellKeyType* key, bool* changed) {
+  for (auto it = deltas.rbegin(); it != deltas.rend(); ++it) {
+    double* value = (*it)->getValue(key);
+    if (value != NULL || (*it)->isCleared(key)) {
+      *changed = true;
+      return value;
+    }
+  }
+  *changed = false;
+  return NULL;
+}
+
+double* Cube::getValue(const CellKeyType* ids) {
+  bool changed = false;
+  double* value = deltas.empty() ? NULL : getChange(ids, &changed);
+  return changed ? value : storage->getValue(ids);
+}
+
+bool Cube::isReplaced(size_t index, const CellKeyType* key) const {
+  for (size_t i = index + 1; i < deltas.size(); i++) {
+    if (deltas[i]->contains(key)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Cube::compactChanges() {
+  if (deltas.empty()) {
+    return;
+  }
+
+  boost::shared_ptr<DoubleStorage> merged(new DoubleStorage(*storage));
+  merged->m.resize(merged->m.size() + numChanged);
+  for (auto delta = deltas.begin(); delta != deltas.end(); ++delta) {
+    const DoubleStorage& cleared = (*delta)->getClearedCells();
+    for (auto it = cleared.m.begin(); it != cleared.m.end(); ++it) {
+      merged->removeValue(&it->first);
+    }
+    const DoubleStorage& cells = (*delta)->getCells();
+    for (auto it = cells.m.begin(); it != cells.m.end(); ++it) {
+      merged->setValue(&it->first, it->second);
+    }
+  }
+
+  // free the unused buckets
+  merged->m.resize(0);
+  storage = merged;
+  columns.reset(columnar ? new ColumnStorage(storage.get(), _dimensions.size())
+                         : NULL);
+  clearChanges();
+}
+
+// add the cells set or removed by the segments of deltas which are not among
+// the segments of others to candidates
+static void collectChangedCells(
+    const vector<boost::shared_ptr<DeltaSegment> >& deltas,
+    const vector<boost::shared_ptr<DeltaSegment> >& others,
+    DoubleStorage* candidates) {
+  for (auto delta = deltas.begin(); delta != deltas.end(); ++delta) {
+    if (find(others.begin(), others.end(), *delta) != others.end()) {
+      continue;
+    }
+    const DoubleStorage* sources[2] = { &(*delta)->getCells(),
+        &(*delta)->getClearedCells() };
+    for (size_t i = 0; i < 2; i++) {
+      for (auto it = sources[i]->m.begin(); it != sources[i]->m.end(); ++it) {
+        candidates->setValue(&it->first, 0);
+      }
+    }
+  }
+}
+
+void Cube::getChangesSince(Cube* older,
+                           vector<pair<CellKeyType, double> >* cells,
+                           vector<pair<CellKeyType, double> >* cleared) {
+  // only the cells in the segments which the versions do not share can
+  // differ
+  DoubleStorage candidates;
+  collectChangedCells(deltas, older->deltas, &candidates);
+  collectChangedCells(older->deltas, deltas, &candidates);
+
+  for (auto it = candidates.m.begin(); it != candidates.m.end(); ++it) {
+    const double* value = getValue(&it->first);
+    const double* olderValue = older->getValue(&it->first);
+    if (value == NULL && olderValue != NULL) {
+      cleared->push_back(make_pair(it->first, 0.0));
+    } else if (value != NULL && (olderValue == NULL || *value != *olderValue)) {
+      cells->push_back(make_pair(it->first, *value));
+    }
+  }
+}
+
 size_t Cube::sizeFilledCells() {
-  return storage->m.size();
+  return storage->m.size() - numHidden + numChanged;
+}
+
+size_t Cube::getMemoryUsage() const {
+  size_t memory = storage->m.bucket_count()
+      * sizeof(*storage->m.begin());
+  if (columns) {
+    memory += columns->getMemoryUsage();
+  }
+  for (auto delta = deltas.begin(); delta != deltas.end(); ++delta) {
+    memory += (*delta)->getMemoryUsage();
+  }
+  return memory;
 }
 
 // TODO(jmeinke): maybe take into account the number of consolidated cells
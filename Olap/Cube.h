@@ -31,6 +31,8 @@
 #ifndef STOAP_OLAP_CUBE_H_
 #define STOAP_OLAP_CUBE_H_ 1
 
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 #include <string>
 #include <vector>
 
@@ -40,6 +42,8 @@
 #include "InputOutput/FileUtils.h"
 #include "Olap/CellPath.h"
 #include "Olap/DoubleStorage.h"
+#include "Olap/ColumnStorage.h"
+#include "Olap/DeltaSegment.h"
 #include "Olap/Dimension.h"
 #include "Olap/Element.h"
 #include "Olap/Area.h"
@@ -53,10 +57,37 @@
 // and setting/getting the values at specific paths
 // A cube path consists of the selected element
 // for each of the cubes dimensions.
+//
+// The cells loaded from the cube file form the base storage, which is never
+// modified and shared by all versions of the cube. Every batch of written
+// cells is published as a DeltaSegment on top of it, which the versions
+// share as well: a new version only adds the segment of its batch. Small
+// segments are merged with the segment below, so a cube has few segments,
+// until compactChanges() merges them into a new base storage.
 
 class Cube {
 
  public:
+  // how the values of a delta file change the cells
+  enum DeltaMode {
+    DELTA_SET,  // the values replace the values of the cells
+    DELTA_ADD,  // the values are added to the values of the cells
+    DELTA_CLEAR  // the cells are removed, the values are ignored
+  };
+
+  // number of cells changed by a delta file
+  struct DeltaCounts {
+    DeltaCounts()
+        : inserted(0),
+          updated(0),
+          removed(0) {
+    }
+
+    size_t inserted;
+    size_t updated;
+    size_t removed;
+  };
+
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief Constructor creating an empty cube
   ////////////////////////////////////////////////////////////////////////////////
@@ -77,6 +108,106 @@ class Cube {
   void loadCube();
   void loadCubeCells(FileReader* file);
 
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Loads the cube values from another loaded version of the cube
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void loadCube(const Cube& version);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Saves the cube values to a file in the format of the cube file
+  ///
+  /// The file is flushed to the disk before the function returns. progress is
+  /// called with the number of cells written every kProgressCells cells and
+  /// after the last cell.
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void saveCube(IdentifierType identifier, const FileName& cubeFileName,
+                const boost::function<void(size_t)>& progress =
+                    boost::function<void(size_t)>());
+
+  static const size_t kProgressCells = 65536;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Reads the cells of the NUMERIC section of a delta file
+  ///
+  /// The cells are applied with applyCells(). Cells with unknown or
+  /// consolidated elements are skipped.
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void readDelta(const FileName& deltaFileName, DeltaMode mode,
+                 vector<pair<CellKeyType, double> >* cells) const;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Applies a batch of base cells to the loaded cube as a new delta
+  /// segment
+  ////////////////////////////////////////////////////////////////////////////////
+
+  DeltaCounts applyCells(const vector<pair<CellKeyType, double> >& cells,
+                         DeltaMode mode);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Merges the delta segments into a new base storage
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void compactChanges();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Collects the cells changed since an older version with the same
+  /// base storage, as cells to set and cells to clear
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void getChangesSince(Cube* older, vector<pair<CellKeyType, double> >* cells,
+                       vector<pair<CellKeyType, double> >* cleared);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Frees the cube values, the cube can be loaded again afterwards
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void unloadCube();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Returns true once the cube values have been loaded
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool isLoaded() const {
+    return loaded;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Returns the wall time in seconds spent loading the cube values
+  ////////////////////////////////////////////////////////////////////////////////
+
+  double getLoadTime() const {
+    return loadTime;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Returns the file name of the cube
+  ////////////////////////////////////////////////////////////////////////////////
+
+  const FileName* getFileName() const {
+    return fileName;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Returns the modification time of the file the values were loaded from
+  ////////////////////////////////////////////////////////////////////////////////
+
+  time_t getFileTime() const {
+    return fileTime;
+  }
+
+  void setFileTime(time_t time) {
+    fileTime = time;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Returns the memory used by the cell storage and its columnar copy
+  ////////////////////////////////////////////////////////////////////////////////
+
+  size_t getMemoryUsage() const;
+
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief Gets the cube dimension list
   ////////////////////////////////////////////////////////////////////////////////
@@ -98,13 +229,85 @@ class Cube {
   size_t sizeMaxCells();
 
   ////////////////////////////////////////////////////////////////////////////////
-  /// @brief gets NUMERIC cell value
+  /// @brief gets the base storage of the NUMERIC cells, without the changes
   ////////////////////////////////////////////////////////////////////////////////
 
   DoubleStorage* getStorage() {
-    return storage;
+    return storage.get();
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief gets the columnar copy of the base cells used for scans, NULL if
+  /// the cube is not columnar
+  ////////////////////////////////////////////////////////////////////////////////
+
+  const ColumnStorage* getColumnStorage() const {
+    return columns.get();
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Sets whether the base cells are copied into a column storage when
+  /// the cube is loaded (default). The columns speed up the scans, but need
+  /// as much memory as the dimensions and values of the cells once more.
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void setColumnar(bool enabled) {
+    columnar = enabled;
+  }
+
+  bool isColumnar() const {
+    return columnar;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief gets a NUMERIC cell value including the changes, NULL if empty
+  ////////////////////////////////////////////////////////////////////////////////
+
+  double* getValue(const CellKeyType* ids);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Returns true if cells were written since the base was built
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool hasChanges() const {
+    return !deltas.empty();
   }
 
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Returns the number of changed cells and hidden base cells
+  ////////////////////////////////////////////////////////////////////////////////
+
+  size_t getChangeCount() const {
+    return numChanged + numHidden;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Returns the number of base cells replaced or removed by the changes
+  ////////////////////////////////////////////////////////////////////////////////
+
+  size_t getHiddenCount() const {
+    return numHidden;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief gets the delta segments with the changed cells, oldest first
+  ////////////////////////////////////////////////////////////////////////////////
+
+  size_t getDeltaCount() const {
+    return deltas.size();
+  }
+
+  const DeltaSegment* getDelta(size_t index) const {
+    return deltas[index].get();
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Returns true if a cell set by a delta segment is replaced or
+  /// removed by a newer one
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool isReplaced(size_t index, const CellKeyType* key) const;
+
   Area* getFilledArea() {
     return filledCellArea;
   }
@@ -115,12 +318,25 @@ class Cube {
 
  private:
   size_t getFileLines(const char *file);
+  bool isBasePath(const IdentifiersType& ids) const;
+  double* getChange(const CellKeyType* key, bool* changed);
+  void hideBaseCell(const CellKeyType* key, DeltaSegment* delta);
+  void addDelta(const boost::shared_ptr<DeltaSegment>& delta);
+  void clearChanges();
   size_t dataLines;
+  bool loaded;
+  bool columnar;
+  double loadTime;
+  time_t fileTime;
 
  protected:
   string name;  // user specified name of the cube
   FileName* fileName;  // file name of the cube
-  DoubleStorage* storage;  // cell storage for NUMERIC values
+  boost::shared_ptr<DoubleStorage> storage;  // base storage for NUMERIC values
+  boost::shared_ptr<ColumnStorage> columns;  // columnar copy of the storage
+  vector<boost::shared_ptr<DeltaSegment> > deltas;  // changes, oldest first
+  size_t numChanged;  // cells set by the changes
+  size_t numHidden;  // base cells replaced or removed by the changes
   vector<Dimension*> _dimensions;  // list of dimensions used for the cube
   vector<size_t> dimensionsSize;  // list of dimension sizes
   Area* filledCellArea;
@@ -0,0 +1,95 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#include "Olap/DeltaSegment.h"
+
+#include <algorithm>
+#include <vector>
+
+DeltaSegment::DeltaSegment()
+    : numHidden(0) {
+}
+
+DeltaSegment::DeltaSegment(const DeltaSegment& older,
+                           const DeltaSegment& newer, size_t dimCount)
+    : cells(older.cells),
+      cleared(older.cleared),
+      numHidden(older.numHidden + newer.numHidden) {
+  cells.m.resize(cells.m.size() + newer.cells.m.size());
+  for (auto it = newer.cleared.m.begin(); it != newer.cleared.m.end(); ++it) {
+    clearValue(&it->first);
+  }
+  for (auto it = newer.cells.m.begin(); it != newer.cells.m.end(); ++it) {
+    setValue(&it->first, it->second);
+  }
+
+  // a base cell is hidden by one segment only, so the rows are distinct.
+  // They are sorted by publish(), the newer segment may not be published.
+  hiddenRows.reserve(older.hiddenRows.size() + newer.hiddenRows.size());
+  hiddenRows.assign(older.hiddenRows.begin(), older.hiddenRows.end());
+  hiddenRows.insert(hiddenRows.end(), newer.hiddenRows.begin(),
+                    newer.hiddenRows.end());
+  publish(dimCount);
+}
+
+void DeltaSegment::setValue(const CellKeyType* key, double value) {
+  cells.setValue(key, value);
+  if (!cleared.m.empty()) {
+    cleared.removeValue(key);
+  }
+}
+
+void DeltaSegment::clearValue(const CellKeyType* key) {
+  cells.removeValue(key);
+  cleared.setValue(key, 0);
+}
+
+void DeltaSegment::hideBaseCell() {
+  numHidden++;
+}
+
+void DeltaSegment::hideBaseCell(size_t row) {
+  hiddenRows.push_back(row);
+  numHidden++;
+}
+
+void DeltaSegment::publish(size_t dimCount) {
+  sort(hiddenRows.begin(), hiddenRows.end());
+
+  // free the unused buckets before the columns are copied in the iteration
+  // order of the cells
+  cells.m.resize(0);
+  cleared.m.resize(0);
+  columns.reset(new ColumnStorage(&cells, dimCount));
+}
+
+size_t DeltaSegment::getMemoryUsage() const {
+  return (cells.m.bucket_count() + cleared.m.bucket_count())
+      * sizeof(*cells.m.begin()) + hiddenRows.capacity() * sizeof(size_t)
+      + (columns ? columns->getMemoryUsage() : 0);
+}
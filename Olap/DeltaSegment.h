@@ -0,0 +1,135 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#ifndef STOAP_OLAP_DELTASEGMENT_H_
+#define STOAP_OLAP_DELTASEGMENT_H_ 1
+
+#include <boost/scoped_ptr.hpp>
+#include <vector>
+
+#include "Olap.h"
+#include "Olap/ColumnStorage.h"
+#include "Olap/DoubleStorage.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief cells written to a cube by a batch of changes
+///
+/// A segment holds the cells set by the batch with their new values, the
+/// cells removed by it and the rows of the base cells it replaces or removes.
+/// Once it has been published the segment is never modified again, so the
+/// versions of a cube share their segments. The cells of a newer segment
+/// replace those of the older ones and of the base.
+////////////////////////////////////////////////////////////////////////////////
+
+class DeltaSegment {
+ public:
+  DeltaSegment();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief Creates the published segment with the changes of two adjacent
+  /// segments, newer ones replacing older ones
+  ////////////////////////////////////////////////////////////////////////////////
+
+  DeltaSegment(const DeltaSegment& older, const DeltaSegment& newer,
+               size_t dimCount);
+
+  // the value set by the segment, NULL if the cell was not set
+  double* getValue(const CellKeyType* key) {
+    return cells.getValue(key);
+  }
+
+  // returns true if the cell was removed by the segment
+  bool isCleared(const CellKeyType* key) {
+    return !cleared.m.empty() && cleared.getValue(key) != NULL;
+  }
+
+  // returns true if the cell was set or removed by the segment
+  bool contains(const CellKeyType* key) {
+    return getValue(key) != NULL || isCleared(key);
+  }
+
+  // make room for count cells to be set
+  void reserve(size_t count) {
+    cells.m.resize(count);
+  }
+
+  // set or remove a cell while the segment is built
+  void setValue(const CellKeyType* key, double value);
+  void clearValue(const CellKeyType* key);
+
+  // count a base cell replaced or removed by the segment, row is its row in
+  // the column storage of the base cells if there is one
+  void hideBaseCell();
+  void hideBaseCell(size_t row);
+
+  // build the columnar copy of the cells, afterwards the segment must not be
+  // changed
+  void publish(size_t dimCount);
+
+  // number of cells set or removed
+  size_t size() const {
+    return cells.m.size() + cleared.m.size();
+  }
+
+  const DoubleStorage& getCells() const {
+    return cells;
+  }
+
+  const DoubleStorage& getClearedCells() const {
+    return cleared;
+  }
+
+  const ColumnStorage* getColumns() const {
+    return columns.get();
+  }
+
+  // number of base cells replaced or removed
+  size_t getHiddenCount() const {
+    return numHidden;
+  }
+
+  // the sorted rows of the base cells replaced or removed, empty if the base
+  // cells have no column storage
+  const vector<size_t>& getHiddenRows() const {
+    return hiddenRows;
+  }
+
+  size_t getMemoryUsage() const;
+
+ private:
+  DeltaSegment(const DeltaSegment&);
+  DeltaSegment& operator=(const DeltaSegment&);
+
+  DoubleStorage cells;
+  DoubleStorage cleared;  // values are unused
+  boost::scoped_ptr<ColumnStorage> columns;
+  vector<size_t> hiddenRows;
+  size_t numHidden;
+};
+
+#endif  // STOAP_OLAP_DELTASEGMENT_H_
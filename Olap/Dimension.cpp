@@ -32,12 +32,9 @@
 #include "Olap/Dimension.h"
 
 #include <iostream>
-#include <deque>
 #include <string>
 #include <vector>
-#include <set>
 
-#include "Collections/DeleteObject.h"
 #include "Collections/StringBuffer.h"
 #include "InputOutput/FileReader.h"
 #include "InputOutput/FileWriter.h"
@@ -45,18 +42,32 @@
 #include "Exceptions/FileFormatException.h"
 #include "Exceptions/ParameterException.h"
 
-ElementsWeightType Dimension::emptyChildren;
-Dimension::ParentsType Dimension::emptyParents;
+// The parents and children of the elements are read in the order of the
+// file, which does not need to be the order of the identifiers. They are
+// collected here and moved into the CSR arrays once all elements are read.
+struct Dimension::StagedLists {
+  explicit StagedLists(uint32_t numElements)
+      : start(numElements, 0),
+        count(numElements, 0) {
+  }
+
+  vector<OffsetType> start;  // start of the list of every element in ids
+  vector<OffsetType> count;  // length of the list of every element
+  vector<IdentifierType> ids;
+  vector<double> weights;
+};
+
+// names are compared ignoring the case, the stored name ends with '\0'
+static bool isEqualName(const string& key, const char* name) {
+  return strncasecmp(key.c_str(), name, key.size()) == 0
+      && name[key.size()] == '\0';
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // constructors and destructors
 ////////////////////////////////////////////////////////////////////////////////
 
-Dimension::Dimension(IdentifierType identifier, const string& name)
-    : parentToChildren(1000, Parent2ChildrenDesc()),
-      childToParents(1000, Child2ParentsDesc()),
-      nameToElement(1000, Name2ElementDesc()),
-      positionToElement(1000, Position2ElementDesc()) {
+Dimension::Dimension(IdentifierType identifier, const string& name) {
   this->identifier = identifier;
   this->name = name;
   numElements = 0;
@@ -69,9 +80,6 @@ Dimension::Dimension(IdentifierType identifier, const string& name)
 }
 
 Dimension::~Dimension() {
-  for_each(elements.begin(), elements.end(), DeleteObject());
-  parentToChildren.clearAndDelete();
-  childToParents.clearAndDelete();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -91,6 +99,9 @@ void Dimension::loadDimension(FileReader* file) {
   isValidLevel = false;
   isValidBaseElements = false;
   isValidSortedElements = false;
+
+  // compute the levels now, so that concurrent queries only read them
+  updateLevelIndentDepth();
 }
 
 uint32_t Dimension::loadOverview(FileReader* file) {
@@ -112,7 +123,6 @@ uint32_t Dimension::loadOverview(FileReader* file) {
         uint32_t depth = file->getDataInteger(4);
 
         sizeElements = file->getDataInteger(5);
-        elements.resize(sizeElements, 0);
 
         maxLevel = level;
         maxIndent = indent;
@@ -142,10 +152,29 @@ void Dimension::loadElements(FileReader* file, uint32_t sizeElements) {
       + StringUtils::convertToString(identifier);
   DLOG(WARNING) << "Load elements from '" << section << "'. " ;
 
-  // construct all elements, unsused elements are cleared later
+  // construct all elements, unused elements keep the type UNDEFINED
+  elements.reserve(sizeElements);
   for (IdentifierType i = 0; i < sizeElements; i++) {
-    elements[i] = new Element(i);
+    elements.push_back(Element(i));
+  }
+
+  // the elements have no relations until all of them have been read
+  parentOffsets.assign(sizeElements + 1, 0);
+  childOffsets.assign(sizeElements + 1, 0);
+
+  // offset 0 is the empty name of the unused elements, the hash table of
+  // the names is at most half full
+  names.assign(1, '\0');
+  nameOffsets.assign(sizeElements, 0);
+  size_t tableSize = 16;
+  while (tableSize < 2 * static_cast<size_t>(sizeElements)) {
+    tableSize *= 2;
   }
+  nameIndex.assign(tableSize, NO_IDENTIFIER);
+  positionIndex.assign(sizeElements, NO_IDENTIFIER);
+
+  StagedLists parents(sizeElements);
+  StagedLists children(sizeElements);
 
   // load elements
   size_t count = 0;
@@ -154,7 +183,11 @@ void Dimension::loadElements(FileReader* file, uint32_t sizeElements) {
     file->nextLine();
 
     while (file->isDataLine()) {
-      loadElement(file, sizeElements);
+      if (count >= sizeElements) {
+        throw FileFormatException("More elements than given in the overview",
+                                  file);
+      }
+      loadElement(file, sizeElements, &parents, &children);
 
       count++;
       file->nextLine();
@@ -163,18 +196,17 @@ void Dimension::loadElements(FileReader* file, uint32_t sizeElements) {
     throw FileFormatException("Section '" + section + "' not found.", file);
   }
 
-  // clear unused elements
-  for (IdentifierType i = 0; i < sizeElements; i++) {
-    if (elements[i]->getElementType() == UNDEFINED) {
-      delete elements[i];
-      elements[i] = 0;
-    }
-  }
+  // move the relations of the used elements into the CSR arrays
+  buildOffsets(parents, &parentOffsets, &parentIds, 0);
+  buildOffsets(children, &childOffsets, &childIds, &childWeights);
+  names.shrink_to_fit();
 
   numElements = count;
 }
 
-void Dimension::loadElement(FileReader* file, uint32_t sizeElements) {
+void Dimension::loadElement(FileReader* file, uint32_t sizeElements,
+                            StagedLists* stagedParents,
+                            StagedLists* stagedChildren) {
   IdentifierType id = file->getDataInteger(0);
   string name = file->getDataString(1);
   PositionType pos = file->getDataInteger(2);
@@ -213,21 +245,27 @@ void Dimension::loadElement(FileReader* file, uint32_t sizeElements) {
     throw FileFormatException("Wrong element identifier found", file);
   }
 
-  Element * element = elements[id];
+  if (pos >= sizeElements) {
+    LOG(ERROR) << "position '" << pos << "' of element '" << name
+                  << "' is greater or equal than maximum (" << sizeElements
+                  << ")";
+    throw FileFormatException("Wrong element position found", file);
+  }
+
+  Element * element = &elements[id];
 
-  element->setName(name);
   element->setPosition(pos);
   element->setLevel(level);
   element->setIndent(indent);
   element->setDepth(depth);
 
   // update name and position
-  nameToElement.addElement(name, element);
-  positionToElement.addElement(pos, element);
+  addElementName(file, element, name);
+  positionIndex[pos] = id;
 
   // children to parent
   if (!parents.empty()) {
-    loadElementParents(file, element, &parents, sizeElements);
+    loadElementParents(file, element, &parents, sizeElements, stagedParents);
   }
 
   // parent to children
@@ -237,7 +275,8 @@ void Dimension::loadElement(FileReader* file, uint32_t sizeElements) {
   }
 
   if (!children.empty()) {
-    loadElementChildren(file, element, &children, &weights, sizeElements);
+    loadElementChildren(file, element, &children, &weights, sizeElements,
+                        stagedChildren);
   }
 
   // check element type for consolidated elements
@@ -256,69 +295,118 @@ void Dimension::loadElement(FileReader* file, uint32_t sizeElements) {
 
 void Dimension::loadElementParents(FileReader* file, Element* element,
                                    IdentifiersType* parents,
-                                   uint32_t sizeElements) {
-  ChildParentsPair * cpp = childToParents.findKey(element);
-
-  if (cpp == 0) {
-    cpp = new ChildParentsPair(element);
-    childToParents.addElement(cpp);
-  }
-
-  ParentsType& pt = cpp->parents;
-  pt.resize(parents->size());
-
-  IdentifiersType::const_iterator parentsIter = parents->begin();
-
-  ParentsType::iterator j = pt.begin();
-
-  for (; parentsIter != parents->end(); parentsIter++, j++) {
-    IdentifierType id = *parentsIter;
-
-    if (id < sizeElements) {
-      *j = elements[id];
-    } else {
-      LOG(ERROR) << "Parent element identifier '" << identifier
-                    << "' of element '" << element->getName()
+                                   uint32_t sizeElements,
+                                   StagedLists* staged) {
+  for (auto i = parents->begin(); i != parents->end(); i++) {
+    if (*i >= sizeElements) {
+      LOG(ERROR) << "Parent element identifier '" << *i
+                    << "' of element '" << getElementName(element)
                     << "' is greater or equal than maximum (" << sizeElements
                     << ")" ;
       throw FileFormatException("Illegal identifier in parents list", file);
     }
   }
+
+  if (staged->ids.size() + parents->size()
+      > numeric_limits<OffsetType>::max()) {
+    throw FileFormatException("Too many parents in dimension", file);
+  }
+
+  IdentifierType id = element->getIdentifier();
+  staged->start[id] = staged->ids.size();
+  staged->count[id] = parents->size();
+  staged->ids.insert(staged->ids.end(), parents->begin(), parents->end());
 }
 
 void Dimension::loadElementChildren(FileReader* file, Element* element,
                                     IdentifiersType* children,
                                     vector<double>* weights,
-                                    uint32_t sizeElements) {
-  ParentChildrenPair * pcp = parentToChildren.findKey(element);
+                                    uint32_t sizeElements,
+                                    StagedLists* staged) {
+  for (auto i = children->begin(); i != children->end(); i++) {
+    if (*i >= sizeElements) {
+      LOG(ERROR) << "Child element identifier '" << *i
+                    << "' of element '" << getElementName(element)
+                    << "' is greater or equal than maximum (" << sizeElements
+                    << ")" ;
+      throw FileFormatException("Illegal identifier in children list", file);
+    }
+  }
 
-  if (pcp == 0) {
-    pcp = new ParentChildrenPair(element);
-    parentToChildren.addElement(pcp);
+  if (staged->ids.size() + children->size()
+      > numeric_limits<OffsetType>::max()) {
+    throw FileFormatException("Too many children in dimension", file);
   }
 
-  ElementsWeightType& ew = pcp->children;
-  ew.resize(children->size());
+  IdentifierType id = element->getIdentifier();
+  staged->start[id] = staged->ids.size();
+  staged->count[id] = children->size();
+  staged->ids.insert(staged->ids.end(), children->begin(), children->end());
+  staged->weights.insert(staged->weights.end(), weights->begin(),
+                         weights->end());
+}
 
-  IdentifiersType::const_iterator childrenIter = children->begin();
-  vector<double>::const_iterator weightsIter = weights->begin();
+void Dimension::buildOffsets(const StagedLists& staged,
+                             vector<OffsetType>* offsets,
+                             vector<IdentifierType>* ids,
+                             vector<double>* weights) {
+  // relations to unused elements, e.g. string elements, are dropped
+  size_t total = 0;
+  for (IdentifierType i = 0; i < elements.size(); i++) {
+    if (isUsed(i)) {
+      OffsetType end = staged.start[i] + staged.count[i];
+      for (OffsetType j = staged.start[i]; j < end; j++) {
+        total += isUsed(staged.ids[j]);
+      }
+    }
+  }
 
-  ElementsWeightType::iterator j = ew.begin();
+  offsets->assign(elements.size() + 1, 0);
+  ids->clear();
+  ids->reserve(total);
+  if (weights != 0) {
+    weights->clear();
+    weights->reserve(total);
+  }
 
-  for (; childrenIter != children->end(); childrenIter++, weightsIter++, j++) {
-    IdentifierType id = *childrenIter;
+  for (IdentifierType i = 0; i < elements.size(); i++) {
+    (*offsets)[i] = ids->size();
+    if (!isUsed(i)) {
+      continue;
+    }
 
-    if (id < sizeElements) {
-      (*j).first = elements[id];
-      (*j).second = *weightsIter;
-    } else {
-      LOG(ERROR) << "Child element identifier '" << identifier
-                    << "' of element '" << element->getName()
-                    << "' is greater or equal than maximum (" << sizeElements
-                    << ")" ;
-      throw FileFormatException("Illegal identifier in children list", file);
+    OffsetType end = staged.start[i] + staged.count[i];
+    for (OffsetType j = staged.start[i]; j < end; j++) {
+      if (isUsed(staged.ids[j])) {
+        ids->push_back(staged.ids[j]);
+        if (weights != 0) {
+          weights->push_back(staged.weights[j]);
+        }
+      }
     }
   }
+  (*offsets)[elements.size()] = ids->size();
+}
+
+void Dimension::addElementName(FileReader* file, Element* element,
+                               const string& name) {
+  if (names.size() + name.size() + 1 > numeric_limits<OffsetType>::max()) {
+    throw FileFormatException("Too many element names in dimension", file);
+  }
+
+  IdentifierType id = element->getIdentifier();
+  nameOffsets[id] = names.size();
+  names.append(name);
+  names.push_back('\0');
+
+  // an element with the same name is replaced
+  size_t mask = nameIndex.size() - 1;
+  size_t i = StringUtils::hashValueLower(name.c_str(), name.size()) & mask;
+  while (nameIndex[i] != NO_IDENTIFIER
+      && !isEqualName(name, &names[nameOffsets[nameIndex[i]]])) {
+    i = (i + 1) & mask;
+  }
+  nameIndex[i] = id;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -345,17 +433,21 @@ DepthType Dimension::getDepth() {
 ////////////////////////////////////////////////////////////////////////////////
 
 void Dimension::clearElements() {
-  for_each(elements.begin(), elements.end(), DeleteObject());
-
-  elements.clear();
-  sortedElements.clear();
+  // swap with empty containers to free the memory
+  vector<Element>().swap(elements);
+  vector<IdentifierType>().swap(sortedElements);
   numElements = 0;
 
-  parentToChildren.clearAndDelete();
-  childToParents.clearAndDelete();
+  vector<OffsetType>().swap(parentOffsets);
+  vector<IdentifierType>().swap(parentIds);
+  vector<OffsetType>().swap(childOffsets);
+  vector<IdentifierType>().swap(childIds);
+  vector<double>().swap(childWeights);
 
-  nameToElement.clear();
-  positionToElement.clear();
+  string().swap(names);
+  vector<OffsetType>().swap(nameOffsets);
+  vector<IdentifierType>().swap(nameIndex);
+  vector<IdentifierType>().swap(positionIndex);
 
   maxLevel = 0;
   maxIndent = 0;
@@ -378,10 +470,9 @@ vector<Element*> Dimension::getElements(IdentifierType level) {
     updateLevelIndentDepth();
   }
 
-  for (vector<Element*>::iterator i = elements.begin(); i != elements.end();
-      i++) {
-    Element * element = *i;
-    if (element == 0) {
+  for (IdentifierType id = 0; id < elements.size(); id++) {
+    Element * element = &elements[id];
+    if (!isUsed(id)) {
       continue;
     } else if (level != NO_IDENTIFIER && element->getLevel(this) != level) {
       continue;
@@ -393,11 +484,10 @@ vector<Element*> Dimension::getElements(IdentifierType level) {
 
 IdentifierType Dimension::getMaximalIdentifier() {
   IdentifierType maxId = 0;
-  for (vector<Element *>::iterator i = elements.begin(); i != elements.end();
-        i++) {
-    IdentifierType id = (*i)->getIdentifier();
-    // cout << id << " >>> " << maxId << endl;
-    if (id > maxId) maxId = id;
+  for (IdentifierType id = 0; id < elements.size(); id++) {
+    if (isUsed(id)) {
+      maxId = id;
+    }
   }
   return maxId;
 }
@@ -407,17 +497,31 @@ vector<Element *> Dimension::getBaseElements() {
     updateLevelIndentDepth();
   }
   vector<Element *> result;
-  for (vector<Element *>::iterator i = elements.begin(); i != elements.end();
-      i++) {
-    Element *element = *i;
-    if (!element || element->getElementType() == CONSOLIDATED) {
+  for (IdentifierType id = 0; id < elements.size(); id++) {
+    if (!isUsed(id) || elements[id].getElementType() == CONSOLIDATED) {
       continue;
     }
-    result.push_back(element);
+    result.push_back(&elements[id]);
   }
   return result;
 }
 
+Element* Dimension::lookupElementByName(const string& name) {
+  if (nameIndex.empty()) {
+    return 0;
+  }
+
+  size_t mask = nameIndex.size() - 1;
+  size_t i = StringUtils::hashValueLower(name.c_str(), name.size()) & mask;
+  for (; nameIndex[i] != NO_IDENTIFIER; i = (i + 1) & mask) {
+    IdentifierType id = nameIndex[i];
+    if (isEqualName(name, &names[nameOffsets[id]])) {
+      return &elements[id];
+    }
+  }
+  return 0;
+}
+
 const IdentifiersWeightType Dimension::getBaseIWs(Element* parent) {
   IdentifiersWeightType baseElements;
 
@@ -471,44 +575,47 @@ void Dimension::updateTopologicalSortedElements() {
 
     isValidSortedElements = true;
 
-    set<Element*> knownElements;  // list of known elements
+    // Kahn's algorithm: an element is added once all of its parents have
+    // been added. The number of parents not added yet is counted along the
+    // lists of children.
+    vector<OffsetType> numParents(elements.size(), 0);
+    for (size_t i = 0; i < childIds.size(); i++) {
+      numParents[childIds[i]]++;
+    }
+
     sortedElements.clear();
-    for (vector<Element*>::iterator i = elements.begin(); i != elements.end();
-        i++) {
-      Element * element = *i;
-
-      set<Element*>::iterator find = knownElements.find(element);
-      if (element != 0 && find == knownElements.end()) {
-        // add parent
-        addParentsToSortedList(element, &knownElements);
-
-        // add element
-        sortedElements.push_back(element);
-        knownElements.insert(element);
+    sortedElements.reserve(elements.size());
+    size_t numUsed = 0;
+    for (IdentifierType id = 0; id < elements.size(); id++) {
+      if (isUsed(id)) {
+        numUsed++;
+        if (numParents[id] == 0) {
+          sortedElements.push_back(id);
+        }
       }
     }
-  }
-}
-
-void Dimension::addParentsToSortedList(Element* child,
-                                       set<Element*>* knownElements) {
-  const ParentsType* pt = getParents(child);
-
-  if (pt == 0) {
-    return;
-  }
-
-  for (ParentsType::const_iterator pti = pt->begin(); pti != pt->end(); pti++) {
-    Element* parent = *pti;
 
-    set<Element*>::iterator find = knownElements->find(parent);
-    if (parent != 0 && find == knownElements->end()) {
-      // add parents
-      addParentsToSortedList(parent, knownElements);
+    // the sorted list is the queue of the elements whose children are next
+    for (size_t next = 0; next < sortedElements.size(); next++) {
+      IdentifierType parent = sortedElements[next];
+      for (OffsetType i = childOffsets[parent]; i < childOffsets[parent + 1];
+          i++) {
+        IdentifierType child = childIds[i];
+        if (--numParents[child] == 0) {
+          sortedElements.push_back(child);
+        }
+      }
+    }
 
-      // add elements
-      sortedElements.push_back(parent);
-      knownElements->insert(parent);
+    // elements on a cycle of consolidations are never added, append them so
+    // that every element gets a level
+    if (sortedElements.size() < numUsed) {
+      LOG(ERROR) << "Dimension '" << name << "' has cyclic consolidations.";
+      for (IdentifierType id = 0; id < elements.size(); id++) {
+        if (isUsed(id) && numParents[id] > 0) {
+          sortedElements.push_back(id);
+        }
+      }
     }
   }
 }
@@ -530,32 +637,26 @@ void Dimension::updateLevelIndentDepth() {
     updateLevel();
 
     // update depth and ident
-    for (deque<Element*>::iterator i = sortedElements.begin();
-        i != sortedElements.end(); i++) {
-      Element * element = *i;
+    for (auto i = sortedElements.begin(); i != sortedElements.end(); i++) {
+      Element * element = &elements[*i];
 
       DepthType depth = 0;
       IndentType indent = 1;
 
-      const ParentsType * parents = getParents(element);
-      if (parents != 0) {
-        // depth
-        for (ParentsType::const_iterator i = parents->begin();
-            i != parents->end(); i++) {
-          Element * parent = *i;
-
-          DepthType d = parent->depth;  // firstParent->getDepth(this);
-          if (depth <= d) {
-            depth = d + 1;
-          }
-        }
+      OffsetType begin = parentOffsets[*i];
+      OffsetType end = parentOffsets[*i + 1];
 
-        // ident
-        if (parents->size() > 0) {
-          Element * firstParent = (*parents)[0];
-          indent = firstParent->indent + 1;  // firstParent->getIndent(this) + 1;
+      // depth
+      for (OffsetType j = begin; j < end; j++) {
+        DepthType d = elements[parentIds[j]].depth;
+        if (depth <= d) {
+          depth = d + 1;
         }
+      }
 
+      // ident
+      if (begin < end) {
+        indent = elements[parentIds[begin]].indent + 1;
       }
 
       if (maxDepth < depth) {
@@ -574,22 +675,14 @@ void Dimension::updateLevelIndentDepth() {
 
 void Dimension::updateLevel() {
   //locked by the caller
-  for (deque<Element*>::reverse_iterator i = sortedElements.rbegin();
-      i != sortedElements.rend(); i++) {
-    Element * element = *i;
-
-    ParentChildrenPair * pcp = parentToChildren.findKey(element);
+  for (auto i = sortedElements.rbegin(); i != sortedElements.rend(); i++) {
+    Element * element = &elements[*i];
     LevelType level = 0;
 
-    if (pcp != 0) {
-      ElementsWeightType children = pcp->children;
-      for (ElementsWeightType::iterator childPair = children.begin();
-          childPair != children.end(); childPair++) {
-        Element * child = childPair->first;
-        LevelType l = child->level;  // child->getLevel(this);
-        if (level <= l) {
-          level = l + 1;
-        }
+    for (OffsetType j = childOffsets[*i]; j < childOffsets[*i + 1]; j++) {
+      LevelType l = elements[childIds[j]].level;
+      if (level <= l) {
+        level = l + 1;
       }
     }
 
@@ -602,7 +695,13 @@ void Dimension::updateLevel() {
 }
 
 size_t Dimension::getMemoryUsageStorage() {
-  return sizeof(Element) * elements.size();
+  return sizeof(Element) * elements.capacity()
+      + sizeof(OffsetType) * (parentOffsets.capacity()
+          + childOffsets.capacity() + nameOffsets.capacity())
+      + sizeof(IdentifierType) * (parentIds.capacity() + childIds.capacity()
+          + nameIndex.capacity() + positionIndex.capacity()
+          + sortedElements.capacity())
+      + sizeof(double) * childWeights.capacity() + names.capacity();
 }
 
 size_t Dimension::sizeElements(bool onlyBase) {
@@ -614,9 +713,8 @@ size_t Dimension::sizeElements(bool onlyBase) {
   }
 
   size_t numBaseElements = 0;
-  for (auto i = elements.begin(); i != elements.end(); i++) {
-    Element *element = *i;
-    if (!element || element->getElementType() == CONSOLIDATED) {
+  for (IdentifierType id = 0; id < elements.size(); id++) {
+    if (!isUsed(id) || elements[id].getElementType() == CONSOLIDATED) {
       continue;
     }
     numBaseElements++;
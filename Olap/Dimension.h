@@ -32,15 +32,12 @@
 #ifndef STOAP_OLAP_DIMENSION_H_
 #define STOAP_OLAP_DIMENSION_H_ 1
 
-#include <set>
 #include <utility>
-#include <deque>
 #include <string>
 #include <vector>
 
 #include "Olap.h"
 #include "Collections/StringUtils.h"
-#include "Collections/AssociativeArray.h"
 #include "Olap/Element.h"
 #include "Exceptions/ParameterException.h"
 
@@ -50,6 +47,13 @@ class Cube;
 
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief class for OLAP dimension
+///
+/// The elements are stored in one vector indexed by their identifier. The
+/// parents and children of all elements are kept in two compressed sparse
+/// row (CSR) arrays: the parents of element i are found at the offsets
+/// parentOffsets[i] to parentOffsets[i + 1] - 1 of parentIds, likewise for
+/// the children and their weights. The names are stored in one string arena
+/// with an open addressing hash table of element identifiers for lookups.
 ////////////////////////////////////////////////////////////////////////////////
 
 class Dimension {
@@ -60,6 +64,12 @@ class Dimension {
 
   typedef vector<Element*> ParentsType;
 
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief offset into the CSR arrays and the name arena
+  ////////////////////////////////////////////////////////////////////////////////
+
+  typedef uint32_t OffsetType;
+
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief creates new dimension with given identifier
   ////////////////////////////////////////////////////////////////////////////////
@@ -86,23 +96,33 @@ class Dimension {
  private:
   uint32_t loadOverview(FileReader* file);
 
+  // parent or child lists in the order of the file, see loadElements()
+  struct StagedLists;
+
   void loadElementParents(FileReader* file, Element* element,
-                          IdentifiersType* parents, uint32_t numElements);
+                          IdentifiersType* parents, uint32_t numElements,
+                          StagedLists* staged);
 
   void loadElementChildren(FileReader* file, Element* element,
                            IdentifiersType* children, vector<double>* weights,
-                           uint32_t numElements);
+                           uint32_t numElements, StagedLists* staged);
 
-  void loadElement(FileReader* file, uint32_t numElements);
+  void loadElement(FileReader* file, uint32_t numElements,
+                   StagedLists* parents, StagedLists* children);
 
   void loadElements(FileReader* file, uint32_t numElements);
 
+  // move staged lists into CSR arrays, dropping unused elements
+  void buildOffsets(const StagedLists& staged, vector<OffsetType>* offsets,
+                    vector<IdentifierType>* ids, vector<double>* weights);
+
+  // add the name of an element to the arena and the hash table
+  void addElementName(FileReader* file, Element* element, const string& name);
+
   // void checkElementName(const string& name);
 
   void updateLevel();
 
-  void addParentsToSortedList(Element* child, set<Element*>* knownElements);
-
   // bool isCycle(const ParentsType*, const ElementsWeightType*);
 
  public:
@@ -161,7 +181,7 @@ class Dimension {
   DepthType getDepth();
 
   ////////////////////////////////////////////////////////////////////////////////
-  /// @brief calculate memory usage of the elements vector
+  /// @brief calculate memory usage of the elements, relations and names
   ////////////////////////////////////////////////////////////////////////////////
 
   size_t getMemoryUsageStorage();
@@ -234,14 +254,27 @@ class Dimension {
 
   size_t sizeElements(bool onlyBase = false);
 
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief returns true if the element with the given identifier is used
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool isUsed(IdentifierType elementIdentifier) const {
+    return elementIdentifier < elements.size()
+        && elements[elementIdentifier].getElementType() != UNDEFINED;
+  }
+
   /**
    * @brief gets all parent elements of a child element
    * @param child is the element whose parents we want to return
    * @return parent elements ordered by position
    */
-  const ParentsType* getParents(Element* child) {
-    ChildParentsPair * cpp = childToParents.findKey(child);
-    return cpp == 0 ? &emptyParents : &cpp->parents;
+  const ParentsType getParents(Element* child) {
+    ParentsType result;
+    IdentifierType id = child->getIdentifier();
+    for (OffsetType i = parentOffsets[id]; i < parentOffsets[id + 1]; i++) {
+      result.push_back(&elements[parentIds[i]]);
+    }
+    return result;
   }
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -251,17 +284,16 @@ class Dimension {
   const ElementsWeightType getChildren(Element* parent) {
     ElementsWeightType result;
     if (parent) {
-      ParentChildrenPair *pcp = parentToChildren.findKey(parent);
-      if (pcp) {
-        result = pcp->children;
+      IdentifierType id = parent->getIdentifier();
+      for (OffsetType i = childOffsets[id]; i < childOffsets[id + 1]; i++) {
+        result.push_back(
+            pair<Element*, double>(&elements[childIds[i]], childWeights[i]));
       }
     } else {
       // root elements
-      ElementsType elems = getElements(NO_IDENTIFIER );
-      for (ElementsType::const_iterator it = elems.begin(); it != elems.end();
-          it++) {
-        if (getParents(*it)->size() == 0) {
-          result.push_back(pair<Element*, double>(*it, 1.0));  // weight not needed for roots
+      for (IdentifierType id = 0; id < elements.size(); id++) {
+        if (isUsed(id) && parentOffsets[id] == parentOffsets[id + 1]) {
+          result.push_back(pair<Element*, double>(&elements[id], 1.0));  // weight not needed for roots
         }
       }
     }
@@ -274,24 +306,16 @@ class Dimension {
   const IdentifiersWeightType getChildrenIds(Element* parent) {
     IdentifiersWeightType result;
     if (parent) {
-      ParentChildrenPair *pcp = parentToChildren.findKey(parent);
-      if (pcp) {
-        //if (!pcp->children.empty()) {
-        for (auto it = pcp->children.begin(); it != pcp->children.end(); ++it) {
-          result.push_back(
-              pair<IdentifierType, double>((*it).first->getIdentifier(),
-                                           (*it).second));
-        }
-        //}
+      IdentifierType id = parent->getIdentifier();
+      for (OffsetType i = childOffsets[id]; i < childOffsets[id + 1]; i++) {
+        result.push_back(
+            pair<IdentifierType, double>(childIds[i], childWeights[i]));
       }
     } else {
       // root elements
-      ElementsType elems = getElements(NO_IDENTIFIER);
-      for (ElementsType::const_iterator it = elems.begin(); it != elems.end();
-          it++) {
-        if (getParents(*it)->size() == 0) {
-          result.push_back(
-              pair<IdentifierType, double>((*it)->getIdentifier(), 1.0));  // weight not needed for roots
+      for (IdentifierType id = 0; id < elements.size(); id++) {
+        if (isUsed(id) && parentOffsets[id] == parentOffsets[id + 1]) {
+          result.push_back(pair<IdentifierType, double>(id, 1.0));  // weight not needed for roots
         }
       }
     }
@@ -316,23 +340,31 @@ class Dimension {
   ////////////////////////////////////////////////////////////////////////////////
 
   Element* lookupElement(IdentifierType elementIdentifier) {
-    return elementIdentifier < elements.size() ? elements[elementIdentifier] : 0;
+    return isUsed(elementIdentifier) ? &elements[elementIdentifier] : 0;
   }
 
   ////////////////////////////////////////////////////////////////////////////////
-  /// @brief gets element by name
+  /// @brief gets element by name, the case of the name is ignored
   ////////////////////////////////////////////////////////////////////////////////
 
-  Element* lookupElementByName(const string& name) {
-    return nameToElement.findKey(name);
-  }
+  Element* lookupElementByName(const string& name);
 
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief gets element by position
   ////////////////////////////////////////////////////////////////////////////////
 
   Element* lookupElementByPosition(PositionType position) {
-    return positionToElement.findKey(position);
+    return position < positionIndex.size()
+        && positionIndex[position] != NO_IDENTIFIER ?
+        &elements[positionIndex[position]] : 0;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief gets the name of an element of the dimension
+  ////////////////////////////////////////////////////////////////////////////////
+
+  const char* getElementName(const Element* element) const {
+    return &names[nameOffsets[element->getIdentifier()]];
   }
 
   void checkLevelIndentDepth();
@@ -347,9 +379,6 @@ class Dimension {
   string name;  // name of the dimension
 
  private:
-  static ElementsWeightType emptyChildren;
-  static ParentsType emptyParents;
-
   // true if maxLevel, maxDepth, and maxIndent are valid
   bool isValidLevel;
   // max level of elements, 0 = base element, levelParent = max(levelChild) + 1
@@ -362,215 +391,21 @@ class Dimension {
   bool isValidBaseElements;  // true if the list of base elements off all elements is valid
 
   bool isValidSortedElements;  // true if the list of topological elements is valid
-  deque<Element*> sortedElements;  // list of topological sorted elements
-
-  struct Name2ElementDesc {
-    uint32_t hash(const string& name) {
-      return StringUtils::hashValueLower(name.c_str(), name.size());
-    }
+  vector<IdentifierType> sortedElements;  // list of topological sorted elements
 
-    bool isEmptyElement(Element * const & element) {
-      return element == 0;
-    }
-
-    uint32_t hashElement(Element * const & element) {
-      return hash(element->getName());
-    }
-
-    uint32_t hashKey(const string& key) {
-      return hash(key);
-    }
-
-    bool isEqualElementElement(Element * const & left,
-                               Element * const & right) {
-      return left->getName() == right->getName();
-    }
-
-    bool isEqualKeyElement(const string& key, Element * const & element) {
-      const string& name = element->getName();
-
-      return key.size() == name.size()
-          && strncasecmp(key.c_str(), name.c_str(), key.size()) == 0;
-    }
-
-    void clearElement(Element * & element) {
-      element = 0;
-    }
-  };
-
-  struct Position2ElementDesc {
-    bool isEmptyElement(Element * const & element) {
-      return element == 0;
-    }
-
-    uint32_t hashElement(Element * const & element) {
-      return element->getPosition();
-    }
-
-    uint32_t hashKey(const PositionType& key) {
-      return key;
-    }
-
-    bool isEqualElementElement(Element * const & left,
-                               Element * const & right) {
-      return left->getPosition() == right->getPosition();
-    }
-
-    bool isEqualKeyElement(const PositionType& key, Element * const & element) {
-      return key == element->getPosition();
-    }
-
-    void clearElement(Element * & element) {
-      element = 0;
-    }
-  };
-
-  struct ParentChildrenPair {
-    explicit ParentChildrenPair(Element * parent)
-        : parent(parent) {
-    }
-
-    Element * parent;
-    ElementsWeightType children;
-  };
-
-  struct Parent2ChildrenDesc {
-    bool isEmptyElement(ParentChildrenPair * const & element) {
-      return element == 0;
-    }
-
-    uint32_t hashElement(ParentChildrenPair * const & element) {
-#if SIZEOF_VOIDP == 8
-      uint64_t p = reinterpret_cast<uint64_t>(element->parent);
-      return (uint32_t) ((p & 0xFFFFFF) ^ (p >> 32));
-#else
-      return reinterpret_cast<uint32_t> (element->parent);
-#endif
-    }
-
-    uint32_t hashKey(Element * const & key) {
-#if SIZEOF_VOIDP == 8
-      uint64_t p = reinterpret_cast<uint64_t>(key);
-      return (uint32_t) ((p & 0xFFFFFF) ^ (p >> 32));
-#else
-      return reinterpret_cast<uint32_t> (key);
-#endif
-    }
-
-    bool isEqualElementElement(ParentChildrenPair * const & left,
-                               ParentChildrenPair * const & right) {
-      return left->parent == right->parent;
-    }
-
-    bool isEqualKeyElement(Element * const & key,
-                           ParentChildrenPair * const & element) {
-      return key == element->parent;
-    }
-
-    void clearElement(ParentChildrenPair * & element) {
-      element = 0;
-    }
-
-    void deleteElement(ParentChildrenPair * & element) {
-      delete element;
-    }
-  };
-
-  struct ChildParentsPair {
-    explicit ChildParentsPair(Element * child)
-        : child(child) {
-    }
-
-    Element * child;
-    ParentsType parents;
-  };
-
-  struct Child2ParentsDesc {
-    bool isEmptyElement(ChildParentsPair * const & element) {
-      return element == 0;
-    }
-
-    uint32_t hashElement(ChildParentsPair * const & element) {
-#if SIZEOF_VOIDP == 8
-      uint64_t p = reinterpret_cast<uint64_t>(element->child);
-      return (uint32_t) ((p & 0xFFFFFF) ^ (p >> 32));
-#else
-      return reinterpret_cast<uint32_t> (element->child);
-#endif
-    }
-
-    uint32_t hashKey(Element * const & key) {
-#if SIZEOF_VOIDP == 8
-      uint64_t p = reinterpret_cast<uint64_t>(key);
-      return (uint32_t) ((p & 0xFFFFFF) ^ (p >> 32));
-#else
-      return reinterpret_cast<uint32_t> (key);
-#endif
-    }
-
-    bool isEqualElementElement(ChildParentsPair * const & left,
-                               ChildParentsPair * const & right) {
-      return left->child == right->child;
-    }
-
-    bool isEqualKeyElement(Element * const & key,
-                           ChildParentsPair * const & element) {
-      return key == element->child;
-    }
-
-    void clearElement(ChildParentsPair * & element) {
-      element = 0;
-    }
-
-    void deleteElement(ChildParentsPair * & element) {
-      delete element;
-    }
-  };
-
-  struct ElementSetDesc {
-    bool isEmptyElement(Element * const & element) {
-      return element == 0;
-    }
-
-    uint32_t hashElement(Element * const & element) {
-#if SIZEOF_VOIDP == 8
-      uint64_t p = reinterpret_cast<uint64_t>(element);
-      return (uint32_t) ((p & 0xFFFFFF) ^ (p >> 32));
-#else
-      return reinterpret_cast<uint32_t> (element);
-#endif
-    }
-
-    uint32_t hashKey(Element * const & key) {
-#if SIZEOF_VOIDP == 8
-      uint64_t p = reinterpret_cast<uint64_t>(key);
-      return (uint32_t) ((p & 0xFFFFFF) ^ (p >> 32));
-#else
-      return reinterpret_cast<uint32_t> (key);
-#endif
-    }
-
-    bool isEqualElementElement(Element * const & left,
-                               Element * const & right) {
-      return left == right;
-    }
-
-    bool isEqualKeyElement(Element * const & key, Element * const & element) {
-      return key == element;
-    }
-
-    void clearElement(Element * & element) {
-      element = 0;
-    }
-  };
-
-  vector<Element*> elements;  // list of elements
+  vector<Element> elements;  // elements by identifier, UNDEFINED if unused
   size_t numElements;  // number of used elements in the list of elements
 
-  AssociativeArray<Element*, ParentChildrenPair*, Parent2ChildrenDesc> parentToChildren;
-  AssociativeArray<Element*, ChildParentsPair*, Child2ParentsDesc> childToParents;
-  AssociativeArray<string, Element*, Name2ElementDesc> nameToElement;
-  AssociativeArray<PositionType, Element*, Position2ElementDesc> positionToElement;
+  vector<OffsetType> parentOffsets;  // start of the parents of every element
+  vector<IdentifierType> parentIds;  // parents of all elements
+  vector<OffsetType> childOffsets;  // start of the children of every element
+  vector<IdentifierType> childIds;  // children of all elements
+  vector<double> childWeights;  // weights of the children
+
+  string names;  // arena of the element names, each terminated by '\0'
+  vector<OffsetType> nameOffsets;  // offset of the name of every element
+  vector<IdentifierType> nameIndex;  // hash table of the names, size 2^n
+  vector<IdentifierType> positionIndex;  // element at every position
 };
 
 #endif  // STOAP_OLAP_DIMENSION_H_
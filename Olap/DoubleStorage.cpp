@@ -34,13 +34,12 @@
 #include "Exceptions/ErrorException.h"
 
 DoubleStorage::DoubleStorage() {
-  const IdentifiersType empty;
+  const CellKeyType empty;
 
   m.set_empty_key(empty);
-  // set deleted key must only be used if we want to use erase
-  // but we don't want to use erase. If we want to use it,
-  // the key must differ from empty key.
-  // m.set_deleted_key(empty);
+  // the deleted key must differ from the empty key and from all cell paths,
+  // which have one identifier per dimension of the cube
+  m.set_deleted_key(CellKeyType(1, NO_IDENTIFIER));
   m.min_load_factor(0.9);
   m.max_load_factor(1.0);
 }
@@ -49,7 +48,7 @@ DoubleStorage::~DoubleStorage() {
   m.clear();
 }
 
-double* DoubleStorage::getValue(const IdentifiersType* ids) {
+double* DoubleStorage::getValue(const CellKeyType* ids) {
   auto it = m.find(*ids);
   if (it == m.end()) {
     return NULL;
@@ -57,7 +56,7 @@ double* DoubleStorage::getValue(const IdentifiersType* ids) {
   return &it->second;
 }
 
-void DoubleStorage::addValue(const IdentifiersType* ids, double value) {
+void DoubleStorage::addValue(const CellKeyType* ids, double value) {
   // auto it = m.find(*ids);
   // if (it == m.end()) {
   //   m[*ids] = value;
@@ -66,6 +65,10 @@ void DoubleStorage::addValue(const IdentifiersType* ids, double value) {
   // }
 }
 
-void DoubleStorage::setValue(const IdentifiersType* ids, double value) {
+void DoubleStorage::setValue(const CellKeyType* ids, double value) {
   m[*ids] = value;
 }
+
+bool DoubleStorage::removeValue(const CellKeyType* ids) {
+  return m.erase(*ids) > 0;
+}
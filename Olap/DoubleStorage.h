@@ -38,9 +38,9 @@
 struct mapops {
   // this comes from boost::hash_combine and stackoverflow
   // http://stackoverflow.com/questions/4948780/magic-number-in-boosthash-combine
-  inline size_t operator()(const IdentifiersType& ids) const {
+  inline size_t operator()(const CellKeyType& ids) const {
     size_t seed = 0;
-    for(IdentifiersType::const_iterator i = ids.begin(); i != ids.end(); ++i) {
+    for(CellKeyType::const_iterator i = ids.begin(); i != ids.end(); ++i) {
       seed ^= *i + 0x9e3779b9 + (seed << 6) + (seed >> 2);
     }
 
@@ -54,12 +54,27 @@ class DoubleStorage  {
   ~DoubleStorage();
 
   // map holding the double values
-  // google::sparse_hash_map<const IdentifiersType, double, mapops> m;
-  google::dense_hash_map<const IdentifiersType, double, mapops> m;
+  // google::sparse_hash_map<const CellKeyType, double, mapops> m;
+  google::dense_hash_map<const CellKeyType, double, mapops> m;
 
-  double* getValue(const IdentifiersType* ids);
-  void addValue(const IdentifiersType* ids, double value);
-  void setValue(const IdentifiersType* ids, double value);
+  double* getValue(const CellKeyType* ids);
+  void addValue(const CellKeyType* ids, double value);
+  void setValue(const CellKeyType* ids, double value);
+
+  // returns false if the cell was not stored
+  bool removeValue(const CellKeyType* ids);
+
+  // first bucket probed when looking up the key
+  size_t getBucket(const CellKeyType* ids) const {
+    return m.hash_funct()(*ids) & (m.bucket_count() - 1);
+  }
+
+  // prefetch the bucket including its inline key, used to batch lookups
+  void prefetchBucket(size_t bucket) const {
+    const char* entry = reinterpret_cast<const char*>(&*m.begin(bucket));
+    __builtin_prefetch(entry);
+    __builtin_prefetch(entry + sizeof(*m.begin(bucket)) - 1);
+  }
 };
 
 #endif  // STOAP_OLAP_DOUBLESTORAGE_H_
@@ -35,7 +35,6 @@
 #define STOAP_OLAP_ELEMENT_H_ 1
 
 #include <string>
-#include <map>
 
 #include "Olap.h"
 #include "Collections/WeightedSet.h"
@@ -57,8 +56,7 @@ class Element {
         position(0),
         type(UNDEFINED),
         level(0),
-        depth(0),
-        numBaseElements(0) {
+        depth(0) {
   }
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -90,22 +88,6 @@ class Element {
     return identifier;
   }
 
-  ////////////////////////////////////////////////////////////////////////////////
-  /// @brief sets or rename element
-  ////////////////////////////////////////////////////////////////////////////////
-
-  void setName(const string& name) {
-    this->name = name;
-  }
-
-  ////////////////////////////////////////////////////////////////////////////////
-  /// @brief gets element name
-  ////////////////////////////////////////////////////////////////////////////////
-
-  const string& getName() const {
-    return name;
-  }
-
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief sets element type
   ////////////////////////////////////////////////////////////////////////////////
@@ -182,11 +164,8 @@ class Element {
 
   IdentifierType identifier;
 
-  ////////////////////////////////////////////////////////////////////////////////
-  /// @brief the name of the element
-  ////////////////////////////////////////////////////////////////////////////////
-
-  string name;
+  // the name of the element is stored by the dimension, see
+  // Dimension::getElementName()
 
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief the position of the element in the list of elements
@@ -218,20 +197,6 @@ class Element {
   ////////////////////////////////////////////////////////////////////////////////
 
   unsigned indent :9;
-
-  ////////////////////////////////////////////////////////////////////////////////
-  /// @brief all base elements
-  /// all base elements and their weight
-  ////////////////////////////////////////////////////////////////////////////////
-
-  map<IdentifierType, double> baseElements;
-
- public:
-  ////////////////////////////////////////////////////////////////////////////////
-  /// @brief number (weight != 0.0) of base elements
-  ////////////////////////////////////////////////////////////////////////////////
-
-  size_t numBaseElements;
 };
 
 #endif  // STOAP_OLAP_ELEMENT_H_
@@ -27,7 +27,14 @@
 
 #include "Stoap/AggregationEnvironment.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -40,7 +47,14 @@
 #include "InputOutput/FileReader.h"
 #include "InputOutput/FileWriter.h"
 #include "InputOutput/FileUtils.h"
+#include "InputOutput/FifoStream.h"
+#include "InputOutput/ResultWriter.h"
 #include "Stoap/AggregationProcessor.h"
+#include "Stoap/CubeCache.h"
+#include "Stoap/RequestParser.h"
+#include "Stoap/SnapshotWriter.h"
+#include "Stoap/WorkerPool.h"
+#include "Engine/AreaFilter.h"
 #include "Exceptions/FileFormatException.h"
 #include "Exceptions/FileOpenException.h"
 #include "Exceptions/ParameterException.h"
@@ -53,16 +67,32 @@ AggrEnv::AggrEnv() {
   _cube = NULL;
   _cubeId = 0;
   _numDimensions = 0;
+  _sortThreshold = 1e6;
+  _prefetch = true;
+  _columnar = true;
+  _numWorkers = max(boost::thread::hardware_concurrency(), 1u);
+  _lazy = false;
+  _memoryBudget = 0;
+  _loadTimeout = 60;
+  _reloadInterval = 0;
+  _journalSize = 0;
+  _cubeCache = NULL;
+  _dirLock = NULL;
+  _snapshotWriter = NULL;
 }
 
 // Parse the command line arguments.
 void AggrEnv::parseCommandLineArguments(int argc, char** argv) {
   struct option options[] = { { "server-mode", 0, NULL, 's' }, { "log-level", 1,
-      NULL, 'v' }, { NULL, 0, NULL, 0 } };
+      NULL, 'v' }, { "sort-threshold", 1, NULL, 't' }, { "no-prefetch", 0,
+      NULL, 'n' }, { "workers", 1, NULL, 'w' }, { "cubes", 1, NULL, 'c' }, { "lazy", 0, NULL,
+      'l' }, { "memory-budget", 1, NULL, 'm' }, { "load-timeout", 1, NULL,
+      'L' }, { "reload-interval", 1, NULL, 'r' }, { "journal", 1, NULL, 'j' },
+      { "no-columns", 0, NULL, 'C' }, { NULL, 0, NULL, 0 } };
 
   optind = 1;
   while (true) {
-    char c = getopt_long(argc, argv, "v:s", options, NULL);
+    char c = getopt_long(argc, argv, "v:st:nw:c:lm:L:r:j:C", options, NULL);
     if (c == -1)
       break;
     switch (c) {
@@ -80,6 +110,83 @@ void AggrEnv::parseCommandLineArguments(int argc, char** argv) {
       case 's':
         _serverMode = true;
         break;
+      case 'n':
+        _prefetch = false;
+        break;
+      case 'C':
+        _columnar = false;
+        break;
+      case 't': {
+          try {
+            _sortThreshold = std::stod(string(optarg));
+            if (_sortThreshold < 0) _sortThreshold = 0;
+          } catch (const std::invalid_argument& ia) {
+            cerr << "Invalid sort-threshold: " << optarg << '\n';
+            printUsageAndExit();
+          }
+        }
+        break;
+      case 'w': {
+          try {
+            int workers = std::stoi(string(optarg));
+            if (workers < 1) {
+              throw std::invalid_argument(optarg);
+            }
+            _numWorkers = workers;
+          } catch (const std::invalid_argument& ia) {
+            cerr << "Invalid number of workers: " << optarg << '\n';
+            printUsageAndExit();
+          }
+        }
+        break;
+      case 'c':
+        _cubeList = optarg;
+        break;
+      case 'l':
+        _lazy = true;
+        break;
+      case 'm': {
+          try {
+            double megabytes = std::stod(string(optarg));
+            if (megabytes < 0) megabytes = 0;
+            _memoryBudget = megabytes * 1024 * 1024;
+          } catch (const std::invalid_argument& ia) {
+            cerr << "Invalid memory-budget: " << optarg << '\n';
+            printUsageAndExit();
+          }
+        }
+        break;
+      case 'L': {
+          try {
+            _loadTimeout = std::stod(string(optarg));
+            if (_loadTimeout < 0) _loadTimeout = 0;
+          } catch (const std::invalid_argument& ia) {
+            cerr << "Invalid load-timeout: " << optarg << '\n';
+            printUsageAndExit();
+          }
+        }
+        break;
+      case 'r': {
+          try {
+            _reloadInterval = std::stod(string(optarg));
+            if (_reloadInterval < 0) _reloadInterval = 0;
+          } catch (const std::invalid_argument& ia) {
+            cerr << "Invalid reload-interval: " << optarg << '\n';
+            printUsageAndExit();
+          }
+        }
+        break;
+      case 'j': {
+          try {
+            double megabytes = std::stod(string(optarg));
+            if (megabytes < 0) megabytes = 0;
+            _journalSize = megabytes * 1024 * 1024;
+          } catch (const std::invalid_argument& ia) {
+            cerr << "Invalid journal size: " << optarg << '\n';
+            printUsageAndExit();
+          }
+        }
+        break;
       default:
         printUsageAndExit();
     }
@@ -90,10 +197,13 @@ void AggrEnv::parseCommandLineArguments(int argc, char** argv) {
   cout << "Log-level: " << FLAGS_minloglevel << endl;
   _databasePath = argv[optind];
   if (_serverMode) {
-    cout << "Server mode: enabled" << endl;
+    cout << "Server mode: enabled (" << _numWorkers << " workers)" << endl;
   } else {
     cout << "Server mode: disabled" << endl;
   }
+  cout << "Sort threshold: " << _sortThreshold << endl;
+  cout << "Prefetching: " << (_prefetch ? "enabled" : "disabled") << endl;
+  cout << "Column storage: " << (_columnar ? "enabled" : "disabled") << endl;
   cout << "Database path: " << _databasePath << endl;
   cout << endl;
 }
@@ -110,7 +220,29 @@ void AggrEnv::printUsageAndExit() {
   cerr
       << " -s, --server-mode: if specified, an input and output FIFO file will be created" << endl
       << "                    in /tmp/stoap-in and /tmp/stoap-out. All logger output goes to" << endl
-      << "                    a log file called 'StOAP.INFO'." << endl;
+      << "                    a log file called 'StOAP.INFO'." << endl
+      << " -t, --sort-threshold: minimum number of target area cells for which the sort" << endl
+      << "                    based aggregation is used (default 1000000, 0 disables it)." << endl
+      << " -n, --no-prefetch: disable the batched and prefetched hash lookups." << endl
+      << " -w, --workers: number of threads answering requests in server mode" << endl
+      << "                    (default: number of CPU cores)." << endl
+      << " -c, --cubes: 'all' or a comma-separated list of cube ids. The cubes are" << endl
+      << "                    loaded in parallel and share the dimensions. Requests are" << endl
+      << "                    routed by their parameter 'cube' (default: first cube)." << endl
+      << " -l, --lazy: load cubes in the background on their first request (server" << endl
+      << "                    mode only). Cubes given with -c are loaded right away." << endl
+      << " -m, --memory-budget: memory in MB the loaded cubes may use before the least" << endl
+      << "                    recently used ones are unloaded (default 0, unlimited)." << endl
+      << " -L, --load-timeout: seconds a request waits for its cube to load (default 60)." << endl
+      << " -r, --reload-interval: seconds between checks for changed cube files, changed" << endl
+      << "                    cubes are reloaded (server mode only, default 0, disabled)." << endl
+      << " -j, --journal: write changed cells to a journal next to the cube file, which" << endl
+      << "                    is replayed when the cube is loaded. Once the journal is larger" << endl
+      << "                    than the given size in MB, the cube is written to its file" << endl
+      << "                    and the journal is truncated (default 0, no journal)." << endl
+      << " -C, --no-columns: do not copy the cells of the cubes into column storages." << endl
+      << "                    Saves 4 bytes per dimension and 8 bytes per cell, but the" << endl
+      << "                    aggregations scan the hash maps of the cubes." << endl;
   exit(1);
 }
 
@@ -182,14 +314,36 @@ void AggrEnv::loadDimensions() {
       throw FileFormatException("section 'DIMENSIONS' not found", file);
     }
 
+    // find the sections of the dimensions, so that the dimensions can be
+    // read in parallel, each starting at its own section
+    FileReader::SectionsType sections;
+    file->indexSections(&sections);
+
     // load dimension data into memory
-    for (auto i = _dimensions.begin(); i != _dimensions.end(); i++) {
-      Dimension* dimension = i->second;
+    cpu_timer timer;
+    size_t numLoaders = min(_numWorkers, _dimensions.size());
+    vector<string> errors(_dimensions.size());
+    {
+      WorkerPool loaders(numLoaders);
+      size_t job = 0;
+      for (auto i = _dimensions.begin(); i != _dimensions.end(); i++, job++) {
+        Dimension* dimension = i->second;
+
+        if (dimension != 0) {
+          loaders.submit(boost::bind(&AggrEnv::loadDimension, dimension,
+                                     dbFileName, &sections, &errors[job]));
+        }
+      }
+    }
 
-      if (dimension != 0) {
-        dimension->loadDimension(file);
+    for (auto i = errors.begin(); i != errors.end(); i++) {
+      if (!i->empty()) {
+        LOG(ERROR) << *i;
       }
     }
+    LOG(INFO) << "Loaded " << _dimensions.size() << " dimensions with "
+              << numLoaders << " threads in " << timer.elapsed().wall / 1e9
+              << " s.";
   } catch (const FileFormatException& e) {
     LOG(ERROR) << e.getMessage();
   }
@@ -197,6 +351,29 @@ void AggrEnv::loadDimensions() {
   delete file;
 }
 
+void AggrEnv::loadDimension(Dimension* dimension, const FileName& dbFileName,
+                            const FileReader::SectionsType* sections,
+                            string* error) {
+  FileReader* file(FileReader::getFileReader(dbFileName));
+
+  try {
+    file->openFile(true, false);
+
+    auto section = sections->find(
+        "DIMENSION "
+            + StringUtils::convertToString(dimension->getIdentifier()));
+    if (section != sections->end()) {
+      file->seekSection(section->second);
+    }
+
+    dimension->loadDimension(file);
+  } catch (const ErrorException& e) {
+    *error = e.getMessage();
+  }
+
+  delete file;
+}
+
 void AggrEnv::addDimension(Dimension* dimension) {
   const string& name = dimension->getName();
 
@@ -302,6 +479,7 @@ void AggrEnv::collectCubeInfo() {
         LOG(INFO) << "Adding cube with filename '" << cubeFileName.fullPath()
                      << "'.";
         Cube* tmpCube = new Cube(name, cubeFileName, &dims);
+        tmpCube->setColumnar(_columnar);
         _cubes[identifier] = tmpCube;
       } else {
         LOG(INFO)<< "One or more dimensions have not been found. Proceeding..."
@@ -325,8 +503,21 @@ void AggrEnv::selectAndLoadCube() {
         << endl;
   }
 
-  // special case: only one usable cube exists or server mode is enabled
-  if (_cubes.size() == 1 || isServerMode()) {
+  if (_lazy && !isServerMode()) {
+    LOG(WARNING) << "Lazy loading is only used in server mode.";
+    _lazy = false;
+  }
+
+  // the cubes to load at startup, or to warm up in lazy mode
+  vector<IdentifierType> ids;
+  if (!_cubeList.empty()) {
+    ids = getCubeList();
+    _cubeId = ids.front();
+  } else if (_lazy) {
+    // the first usable cube is loaded on the first request
+    _cubeId = _cubes.begin()->first;
+  } else if (_cubes.size() == 1 || isServerMode()) {
+    // special case: only one usable cube exists or server mode is enabled
     if (isServerMode()) {
       // we're in server mode -> select the first usable cube
       LOG(ERROR) << "Server mode is enabled. The first usable cube will be selected.";
@@ -334,7 +525,7 @@ void AggrEnv::selectAndLoadCube() {
 
     // assign the first cube
     _cubeId = _cubes.begin()->first;
-    _cube = _cubes.begin()->second;
+    ids.push_back(_cubeId);
 
   } else {
     LOG(ERROR) << "There are multiple cubes.";
@@ -353,14 +544,74 @@ void AggrEnv::selectAndLoadCube() {
     }
     // assign the cube
     _cubeId = x;
-    _cube = _cubes.find(x)->second;
+    ids.push_back(_cubeId);
+  }
+
+  // the journals must not be written by two processes
+  if (_journalSize > 0) {
+    _dirLock = new DirLock(_databasePath);
+  }
+
+  // load the cubes in parallel, they only read the shared dimensions. The
+  // cache owns the cubes from now on.
+  _cubeCache = new CubeCache(_cubes, min(_numWorkers, _cubes.size()),
+                             _memoryBudget, _loadTimeout,
+                             isServerMode() ? _reloadInterval : 0,
+                             _journalSize);
+  _snapshotWriter = new SnapshotWriter();
+  for (auto it = ids.begin(); it != ids.end(); ++it) {
+    _cubeCache->prefetch(*it);
+  }
+  if (!_lazy) {
+    cpu_timer timer;
+    _cubeCache->waitForLoads();
+    LOG(INFO) << "Loaded the cubes in " << timer.elapsed().wall / 1e9 << " s.";
+
+    // the first loaded cube answers requests without a cube id
+    auto it = ids.begin();
+    while (it != ids.end() && !_cubeCache->isLoaded(*it)) {
+      ++it;
+    }
+    if (it == ids.end()) {
+      LOG(FATAL) << "None of the cubes could be loaded.";
+    }
+    _cubeId = *it;
+  }
+
+  // the CLI works on the default cube, which stays loaded and is never
+  // reloaded
+  if (!isServerMode()) {
+    _cube = _cubeCache->acquire(_cubeId).get();
   }
-  // load the cube
-  LOG(INFO) << "Loading cube '" << _cube->getName() << "'.";
-  _cube->loadCube();
+}
 
-  LOG(INFO) << "Loaded " << _cube->sizeFilledCells() << " base cells into '"
-               << _cube->getName() << "'.";
+vector<IdentifierType> AggrEnv::getCubeList() {
+  vector<IdentifierType> ids;
+  if (_cubeList == "all") {
+    for (auto it = _cubes.begin(); it != _cubes.end(); ++it) {
+      ids.push_back(it->first);
+    }
+    return ids;
+  }
+
+  vector<string> words;
+  StringUtils::splitString(_cubeList, &words, ',');
+  for (auto it = words.begin(); it != words.end(); ++it) {
+    IdentifierType id = NO_IDENTIFIER;
+    try {
+      id = std::stoi(*it);
+    } catch (const std::exception& e) {
+      // reported below as an unknown id
+    }
+    if (_cubes.find(id) == _cubes.end()) {
+      LOG(FATAL) << "'" << *it << "' is not the id of a usable cube.";
+    }
+    ids.push_back(id);
+  }
+  if (ids.empty()) {
+    LOG(FATAL) << "The list of cubes is empty.";
+  }
+  return ids;
 }
 
 // Open pipes for input and output
@@ -371,169 +622,395 @@ void AggrEnv::openPipe() {
   unlink(FIFO_OUT);
 
   FILE *fpin;
-  FILE *fpout;
-  const int kBufferSize = 100000;
-  char readbuf[kBufferSize];
+  char* readbuf = NULL;
+  size_t bufferSize = 0;
 
   umask(0);
   mknod(FIFO_IN, S_IFIFO | 0666, 0);
   mknod(FIFO_OUT, S_IFIFO | 0666, 0);
 
+  // a client which stops reading its answer must not terminate the server
+  signal(SIGPIPE, SIG_IGN);
+
+  // the FIFO is opened for writing as well, so it stays open when the last
+  // client closes it and requests of several clients cannot get lost
+  int fd = open(FIFO_IN, O_RDWR);
+  if (fd < 0 || (fpin = fdopen(fd, "r")) == NULL) {
+    LOG(FATAL) << "open fifo in failed.";
+  }
+
+  LOG(INFO) << "Answering requests with " << _numWorkers << " workers.";
+  WorkerPool workers(_numWorkers);
+
+  // the answers on the shared output FIFO are sent one after the other, in
+  // the order the requests were received, by a thread of their own. A client
+  // which does not read the shared FIFO only holds up this thread, never the
+  // workers answering on private FIFOs.
+  WorkerPool fifoOutWriter(1);
+
   while (!_exitRequested) {
-    // opening the FIFO read-only blocks until some other process opens the FIFO for writing.
+    // every line is a request, reading blocks until a client sends one. The
+    // buffer grows with the line, so long requests are never split.
     LOG(INFO) << "Waiting for a query...";
-    if ((fpin = fopen(FIFO_IN, "r")) == NULL) {
-      LOG(FATAL) << "fopen fifo in failed.";
-    } else {
-      LOG(INFO) << "Client is available.";
-
-      if (fgets(readbuf, kBufferSize, fpin) == NULL) {
-        LOG(FATAL) << "fgets fifo in failed.";
-      }
+    if (getline(&readbuf, &bufferSize, fpin) < 0) {
+      LOG(FATAL) << "getline fifo in failed.";
+    }
 
-      string query(readbuf);
-      LOG(INFO) << "Received query '" << query << "'.";
+    string query = StringUtils::trim(readbuf);
+    LOG(INFO) << "Received query '" << query << "'.";
 
-      // opening the FIFO write-only blocks until some other process opens the FIFO for reading.
-      if ((fpout = fopen(FIFO_OUT, "w")) == NULL) {
-        LOG(FATAL) << "fopen fifo out failed.";
-      } else {
-        LOG(INFO) << "Reader is available.";
+    string outPath;
+    if (!getReplyPath(query, &outPath)) {
+      continue;
+    }
 
-        string answer = handleRequest(query);
+    WorkerPool& pool = outPath == FIFO_OUT ? fifoOutWriter : workers;
+    pool.submit(boost::bind(&AggrEnv::serveRequest, this, query, outPath));
+  }
+  free(readbuf);
+  fclose(fpin);
+}
 
-        // LOG(INFO) << "Answer is:\n" << answer;
-        fputs(answer.c_str(), fpout);
-        if (ferror(fpout)) {
-          LOG(FATAL) << "fputs fifo out failed.";
-        }
-        // signal EOF to the reader
-        fclose(fpout);
+bool AggrEnv::getReplyPath(const string& request, string* outPath) const {
+  *outPath = FIFO_OUT;
+
+  RequestParser parser(request);
+  if (parser.parse()) {
+    const RequestParser::Slice* reply = parser.getParam("reply");
+    if (reply != NULL) {
+      try {
+        *outPath += "." + StringUtils::convertToString(
+            parser.parseNumber(*reply, "reply id"));
+      } catch (const ErrorException& e) {
+        LOG(ERROR) << "Dropped request '" << request << "': "
+                   << e.getMessage();
+        return false;
+      }
 
-        LOG(INFO) << "Reader has picked up the answer.";
+      // only answer on FIFOs created by the client, never create files
+      struct stat info;
+      if (stat(outPath->c_str(), &info) != 0 || !S_ISFIFO(info.st_mode)) {
+        LOG(ERROR) << "Dropped request '" << request << "': '" << *outPath
+                   << "' is not a FIFO.";
+        return false;
       }
-      fclose(fpin);
     }
   }
+  return true;
 }
 
-string AggrEnv::handleRequest(const string& request) {
-  string result;
-
-  vector<string> reqWords;
-  StringUtils::splitString(request, &reqWords, '?');
+// compute the answer straight into the FIFO, so the client receives it in
+// chunks while it is computed. Closing the FIFO signals EOF to the reader.
+void AggrEnv::writeAnswer(const string& request, int fd,
+                          const string& outPath) const {
+  FifoStream out(fd);
+  LOG(INFO) << "Reader is available.";
+  handleRequest(request, out);
+  if (!out.flush()) {
+    LOG(ERROR) << "writing to '" << outPath << "' failed.";
+  } else {
+    LOG(INFO) << "Reader has picked up the answer.";
+  }
+}
 
-  // there should always be a request and parameters
-  if (reqWords.size() != 2) {
-    result =
-        "Error: wrong request format. Should be of the form '/request?param1=value&param2=value&..'.";
-    return result;
+void AggrEnv::serveRequest(const string& request, const string& outPath) {
+  if (outPath != FIFO_OUT) {
+    // a client which died or never reads its FIFO must not block the worker,
+    // opening fails with ENXIO until the client opens the FIFO for reading.
+    // Clients usually open it right after sending the request, so the delay
+    // between the attempts starts short and grows up to 10 ms.
+    int fd = -1;
+    int64_t waited = 0;
+    for (int delay = 100; ; delay = min(delay * 2, 10000)) {
+      fd = open(outPath.c_str(), O_WRONLY | O_NONBLOCK);
+      if (fd >= 0 || errno != ENXIO || waited >= kReplyTimeout * 1000) {
+        break;
+      }
+      usleep(delay);
+      waited += delay;
+    }
+    if (fd < 0) {
+      LOG(ERROR) << "Dropped request '" << request << "': '" << outPath
+                 << "' was not opened for reading.";
+      return;
+    }
+    // the answer is written blocking, while the client reads it
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    writeAnswer(request, fd, outPath);
+    return;
   }
 
-  // the first part of the query is the request
-  string req = reqWords[0];
+  // the reader of the previous answer only sees EOF if no writer has opened
+  // the FIFO again before it reads, otherwise it would get both answers
+  double closed = _fifoOutClosed.elapsed().wall / 1e6;
+  if (closed < kAnswerGap) {
+    usleep((kAnswerGap - closed) * 1000);
+  }
 
-  // there are only two supported requests: /cell/values and /cell/area
-  if (req != "/cell/values" && req != "/cell/area") {
-    stringstream ss;
-    ss << req
-       << ": Unsupported request. Only /cell/values and /cell/area are supported."
-       << endl;
-    return ss.str();
+  // opening the FIFO write-only blocks until some other process opens the FIFO for reading.
+  int fd = open(outPath.c_str(), O_WRONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "open '" << outPath << "' failed.";
+  } else {
+    writeAnswer(request, fd, outPath);
   }
 
-  // the second part are the parameters (param=value&param2=value2&...)
-  vector<string> reqKeyValuePairs;
-  StringUtils::splitString(reqWords[1], &reqKeyValuePairs, '&');
-
-  // now literally "map" every key and value
-  map<string, string> params;
-  for (auto kvp = reqKeyValuePairs.begin(); kvp != reqKeyValuePairs.end();
-      ++kvp) {
-    vector<string> keyValuePair;
-    StringUtils::splitString(*kvp, &keyValuePair, '=');
-    if (keyValuePair.size() != 2) {
-      // wrong format -> skip
-      continue;
+  _fifoOutClosed.start();
+}
+
+void AggrEnv::handleRequest(const string& request, ostream& out) const {
+  RequestParser parser(request);
+
+  // requests without a cube id are answered by the default cube
+  IdentifierType cubeId = _cubeId;
+
+  // the answer is sent as text unless the binary format is requested
+  bool binary = false;
+  try {
+    // there should always be a request and parameters
+    if (!parser.parse()) {
+      out << "Error: wrong request format. Should be of the form '/request?param1=value&param2=value&..'.";
+      return;
+    }
+
+    // the supported requests are /cell/values, /cell/area,
+    // /cell/replace_bulk, /cube/reload, /cube/delta and /cube/save
+    const RequestParser::Slice& req = parser.getPath();
+    if (req != "/cell/values" && req != "/cell/area"
+        && req != "/cell/replace_bulk" && req != "/cube/reload"
+        && req != "/cube/delta" && req != "/cube/save") {
+      out << req.str()
+          << ": Unsupported request. Only /cell/values, /cell/area, /cell/replace_bulk, /cube/reload, /cube/delta and /cube/save are supported."
+          << endl;
+      return;
+    }
+
+    const RequestParser::Slice* cubeParam = parser.getParam("cube");
+    if (cubeParam != NULL) {
+      cubeId = parser.parseNumber(*cubeParam, "cube id");
+    }
+
+    // the new version is loaded in the background, requests are answered by
+    // the current version until it is complete
+    if (req == "/cube/reload") {
+      _cubeCache->reload(cubeId);
+      out << "Reloading cube " << cubeId << "." << endl;
+      return;
+    }
+
+    // the delta is applied to a copy of the cube, requests are answered by
+    // the current version until it is complete
+    if (req == "/cube/delta") {
+      const RequestParser::Slice* file = parser.getParam("file");
+      if (file == NULL || file->empty()) {
+        out << "Error: the parameter 'file' is required for /cube/delta.";
+        return;
+      } else if (file->str().find('/') != string::npos) {
+        out << "Error: the delta file must be in the database directory.";
+        return;
+      }
+
+      Cube::DeltaMode mode = Cube::DELTA_SET;
+      const RequestParser::Slice* modeParam = parser.getParam("mode");
+      if (modeParam != NULL) {
+        if (*modeParam == "add") {
+          mode = Cube::DELTA_ADD;
+        } else if (*modeParam == "clear") {
+          mode = Cube::DELTA_CLEAR;
+        } else if (*modeParam != "set") {
+          out << "Error: the parameter 'mode' must be 'set', 'add' or 'clear'.";
+          return;
+        }
+      }
+
+      cpu_timer timer;
+      vector<pair<CellKeyType, double> > cells;
+      CubeCache::Pin(_cubeCache, cubeId).get()->readDelta(
+          FileName(_databasePath, file->str(), "csv"), mode, &cells);
+      Cube::DeltaCounts counts = _cubeCache->changeCube(cubeId, cells, mode);
+      out << "Applied delta to cube " << cubeId << ": " << counts.inserted
+          << " inserted, " << counts.updated << " updated, " << counts.removed
+          << " removed in " << timer.elapsed().wall / 1e9 << " s." << endl;
+      return;
+    }
+
+    // the cube is written by a child process, without a file the status of
+    // the last save is sent
+    if (req == "/cube/save") {
+      const RequestParser::Slice* file = parser.getParam("file");
+      if (file == NULL) {
+        printSaveStatus(cubeId, out);
+      } else {
+        saveCube(cubeId, file->str(), out);
+      }
+      return;
     }
-    params[keyValuePair[0]] = keyValuePair[1];
-  }
 
-  if (params.find("cube") != params.end()) {
-    IdentifierType cubeId = static_cast<IdentifierType>(stol(params.at("cube")));
-    if (_cubeId != cubeId) {
-      stringstream ss;
-      ss << "Error: the parameter 'cubeId' (" << cubeId
-         << ") does not point to the currently loaded cube (Id " << _cubeId
-         << ").";
-      return ss.str();
+    const RequestParser::Slice* format = parser.getParam("format");
+    if (format != NULL) {
+      if (*format == "binary") {
+        binary = true;
+      } else if (*format != "text") {
+        out << "Error: the parameter 'format' must be 'text' or 'binary'.";
+        return;
+      }
     }
+  } catch (const ErrorException& e) {
+    out << "Error: " << e.getMessage() << endl;
+    return;
+  }
+
+  // the cube is loaded if necessary and cannot be unloaded until the answer
+  // has been sent
+  boost::scoped_ptr<CubeCache::Pin> pin;
+  try {
+    pin.reset(new CubeCache::Pin(_cubeCache, cubeId));
+  } catch (const ErrorException& e) {
+    out << "Error: " << e.getMessage() << endl;
+    return;
   }
+  Cube* cube = pin->get();
+  const vector<Dimension*>& cubeDimensions = *(cube->getDimensions());
+  if (parser.getPath() == "/cell/replace_bulk") {
+    const RequestParser::Slice* paths = parser.getParam("paths");
+    const RequestParser::Slice* values = parser.getParam("values");
+    if (paths == NULL || values == NULL) {
+      out << "Error: the parameters 'paths' and 'values' are required for /cell/replace_bulk.";
+      return;
+    } else if (paths->empty() || values->empty()) {
+      out << "Error: the parameter 'paths' or 'values' is empty.";
+      return;
+    }
+
+    try {
+      vector<CellKeyType> cellPaths;
+      parser.parsePaths(*paths, cubeDimensions, &cellPaths);
+      vector<double> cellValues;
+      parser.parseValues(*values, &cellValues);
+      if (cellPaths.size() != cellValues.size()) {
+        out << "Error: " << cellPaths.size() << " paths but "
+            << cellValues.size() << " values were given.";
+        return;
+      }
+
+      // only base cells are stored, consolidated values are aggregated
+      vector<pair<CellKeyType, double> > cells;
+      cells.reserve(cellPaths.size());
+      for (size_t i = 0; i < cellPaths.size(); ++i) {
+        CellPath cellPath(&cellPaths[i], &cubeDimensions);
+        if (!cellPath.isBase()) {
+          out << "Error: the cell path " << cellPath.toString()
+              << " is not a base cell.";
+          return;
+        }
+        cells.push_back(make_pair(cellPaths[i], cellValues[i]));
+      }
 
-  if (req == "/cell/values") {
-    if (params.find("paths") == params.end()) {
-      result = "Error: the parameter 'paths' is required for /cell/values.";
-      return result;
-    } else if (params.at("paths").empty()) {
-      result = "Error: the parameter 'paths' is empty.";
-      return result;
+      // all cells are written to a new version of the cube, so other
+      // requests see either all or none of them
+      Cube::DeltaCounts counts = _cubeCache->changeCube(cubeId, cells,
+                                                        Cube::DELTA_SET);
+      out << "Replaced " << cells.size() << " cells of cube " << cubeId
+          << ": " << counts.inserted << " inserted, " << counts.updated
+          << " updated." << endl;
+    } catch (const ErrorException& e) {
+      out << "Error: " << e.getMessage() << endl;
+    }
+    return;
+
+  } else if (parser.getPath() == "/cell/values") {
+    const RequestParser::Slice* paths = parser.getParam("paths");
+    if (paths == NULL) {
+      out << "Error: the parameter 'paths' is required for /cell/values.";
+      return;
+    } else if (paths->empty()) {
+      out << "Error: the parameter 'paths' is empty.";
+      return;
     }
 
     try {
-      stringstream ss;
-      vector<IdentifiersType> cellPaths = getCellsFromUrl(params["paths"]);
+      vector<CellKeyType> cellPaths;
+      parser.parsePaths(*paths, cubeDimensions, &cellPaths);
 
-      vector<IdentifiersType> areaPaths(cellPaths.at(0).size(), IdentifiersType());
+      vector<IdentifiersType> areaPaths(cubeDimensions.size());
       for (size_t path = 0; path < cellPaths.size(); ++path) {
-        for (size_t dim = 0; dim < cellPaths.at(path).size(); ++dim) {
-          IdentifierType el = cellPaths.at(path).at(dim);
-          if (find(areaPaths.at(dim).begin(), areaPaths.at(dim).end(), el) != areaPaths.at(dim).end())
-             continue;
-          areaPaths.at(dim).push_back(el);
+        for (size_t dim = 0; dim < cellPaths[path].size(); ++dim) {
+          areaPaths[dim].push_back(cellPaths[path][dim]);
         }
       }
+      for (auto it = areaPaths.begin(); it != areaPaths.end(); ++it) {
+        sort(it->begin(), it->end());
+        it->erase(unique(it->begin(), it->end()), it->end());
+      }
 
-      CubeArea queryArea(this, &(*_cube), Area(areaPaths));
+      CubeArea queryArea(this, cube, Area(areaPaths));
       AggregationProcessor aggrProc(&queryArea, AggregationProcessor::SUM);
       aggrProc.aggregate();
-      ss << aggrProc.result(cellPaths, false, true);
-
-      return ss.str();
+      if (binary) {
+        BinaryResultWriter writer(&out, cellPaths.size());
+        aggrProc.streamResult(&writer, cellPaths);
+        writer.finish();
+      } else {
+        TextResultWriter writer(&out, false, true);
+        aggrProc.streamResult(&writer, cellPaths);
+        writer.finish();
+      }
+      return;
 
     } catch (const ErrorException& e) {
-      stringstream ss;
-      ss << "Error in cell path: " << e.getMessage() << endl;
-      return ss.str();
+      out << "Error in cell path: " << e.getMessage() << endl;
+      return;
+    }
+
+  } else {
+    const RequestParser::Slice* areaParam = parser.getParam("area");
+    if (areaParam == NULL) {
+      out << "Error: the parameter 'area' is required for /cell/area.";
+      return;
+    } else if (areaParam->empty()) {
+      out << "Error: the parameter 'area' is empty.";
+      return;
     }
 
-  } else if (req == "/cell/area") {
-    if (params.find("area") == params.end()) {
-      result = "Error: the parameter 'area' is required for /cell/area.";
-      return result;
-    } else if (params.at("area").empty()) {
-      result = "Error: the parameter 'area' is empty.";
-      return result;
+    // only the filled cells are sent in sparse mode
+    const RequestParser::Slice* sparseParam = parser.getParam("sparse");
+    bool sparse = sparseParam != NULL && *sparseParam == "1";
+    if (sparse && binary) {
+      out << "Error: the parameter 'sparse' is only supported for format=text.";
+      return;
     }
 
     try {
-      stringstream ss;
-      vector<IdentifiersType> cellArea = getAreaPathFromUrl(params["area"]);
-      vector<IdentifiersType> paths = dotPaths(cellArea);
+      vector<IdentifiersType> cellArea;
+      parser.parseArea(*areaParam, cubeDimensions, &cellArea);
 
-      CubeArea queryArea(this, &(*_cube), cellArea);
+      CubeArea queryArea(this, cube, cellArea);
       AggregationProcessor aggrProc(&queryArea, AggregationProcessor::SUM);
       aggrProc.aggregate();
-      ss << aggrProc.result(paths, true, true);
-      return ss.str();
+      if (sparse) {
+        TextResultWriter writer(&out, true, true);
+        aggrProc.streamSparseResult(&writer);
+        writer.finish();
+      } else if (binary) {
+        uint64_t numCells = 1;
+        for (auto it = cellArea.begin(); it != cellArea.end(); ++it) {
+          numCells *= it->size();
+        }
+        BinaryResultWriter writer(&out, numCells);
+        aggrProc.streamResult(&writer, cellArea);
+        writer.finish();
+      } else {
+        TextResultWriter writer(&out, true, true);
+        aggrProc.streamResult(&writer, cellArea);
+        writer.finish();
+      }
+      return;
 
     } catch (const ErrorException& e) {
-      stringstream ss;
-      ss << "Error: " << e.getMessage() << endl;
-      return ss.str();
+      out << "Error: " << e.getMessage() << endl;
+      return;
     }
   }
-
-  return result;
 }
 
 void AggrEnv::askQuery() {
@@ -574,9 +1051,6 @@ void AggrEnv::askQuery() {
 }
 
 bool AggrEnv::processQuery(const string& query) {
-  // ideas for more commands
-  // - save cube data to file
-
   vector<string> queryWords;
   StringUtils::splitString(query, &queryWords, ' ');
 
@@ -595,8 +1069,12 @@ bool AggrEnv::processQuery(const string& query) {
       printDimensionInfo();
     } else if (queryWords[1] == "cube") {
       printCubeInfo();
+    } else if (queryWords[1] == "cubes") {
+      printCubesInfo();
     } else if (queryWords[1] == "storage") {
       printStorageInfo();
+    } else if (queryWords[1] == "save") {
+      printSaveStatus(_cubeId, cout);
     } else {
       cout << "error: unkown option " << queryWords[1] << " for info" << endl;
     }
@@ -608,6 +1086,10 @@ bool AggrEnv::processQuery(const string& query) {
     if (!checkNumArguments(cmd, numArgs, 1))
       return true;
     printAreaValues(queryWords[1]);
+  } else if (cmd == "save") {
+    if (!checkNumArguments(cmd, numArgs, 1))
+      return true;
+    saveCube(_cubeId, queryWords[1], cout);
   } else if (cmd == "help") {
     cout << "Available commands:" << endl;
     cout << "\texit" << endl;
@@ -622,7 +1104,9 @@ bool AggrEnv::processQuery(const string& query) {
     cout << "\t\t- getArea 10x14x5x13x0-18,20-63" << endl;
     cout << "\t\t- getArea 10-14x14x5x13-24x62-64" << endl;
     cout << "\t\t- getArea 13x14x5x19x33-64" << endl;
-    cout << "\tinfo <cube|dimensions|storage>" << endl;
+    cout << "\tsave <name> writes the cube to <name>.csv in the background."
+         << endl;
+    cout << "\tinfo <cube|cubes|dimensions|storage|save>" << endl;
     cout << "\thelp" << endl;
   } else {
     cout << cmd << ": unknown command" << endl;
@@ -671,6 +1155,75 @@ void AggrEnv::printCubeInfo() {
        << endl;
 }
 
+void AggrEnv::printCubesInfo() {
+  cout << "===================================================================="
+       << endl;
+  vector<pair<IdentifierType, boost::shared_ptr<Cube> > > loaded =
+      _cubeCache->getLoadedCubes();
+  cout << "There are " << loaded.size() << " loaded cubes:" << endl;
+  size_t totalMemory = 0;
+  for (auto it = loaded.begin(); it != loaded.end(); ++it) {
+    Cube* cube = it->second.get();
+    cout << "\tCube '" << cube->getName() << "' with Id " << it->first
+         << (cube == _cube ? " (default):" : ":") << endl;
+    cout << "\t\tFilled cells: " << cube->sizeFilledCells() << endl;
+    cout << "\t\tMemory usage: " << cube->getMemoryUsage() << " bytes" << endl;
+    cout << "\t\tLoad time: " << cube->getLoadTime() << " s" << endl;
+    cout << "" << endl;
+    totalMemory += cube->getMemoryUsage();
+  }
+
+  // the dimensions are shared by all cubes
+  size_t dimensionMemory = 0;
+  for (auto it = _dimensions.begin(); it != _dimensions.end(); ++it) {
+    dimensionMemory += it->second->getMemoryUsageStorage();
+  }
+  cout << "Cubes:\t\t" << totalMemory << " bytes" << endl;
+  cout << "Dimensions:\t" << dimensionMemory << " bytes (shared)" << endl;
+  cout << "===================================================================="
+       << endl;
+}
+
+void AggrEnv::saveCube(IdentifierType cubeId, const string& name,
+                       ostream& out) const {
+  if (name.empty() || name.find('/') != string::npos) {
+    out << "Error: the file must be in the database directory." << endl;
+    return;
+  } else if (name.compare(0, 8, "database") == 0) {
+    out << "Error: the files of the database cannot be overwritten." << endl;
+    return;
+  }
+
+  // the child process writes the version of the cube pinned at the fork
+  try {
+    FileName fileName(_databasePath, name, "csv");
+    CubeCache::Pin pin(_cubeCache, cubeId);
+    _snapshotWriter->save(cubeId, pin.get(), fileName);
+    out << "Saving cube " << cubeId << " to '" << fileName.fullPath() << "'."
+        << endl;
+  } catch (const ErrorException& e) {
+    out << "Error: " << e.getMessage() << endl;
+  }
+}
+
+void AggrEnv::printSaveStatus(IdentifierType cubeId, ostream& out) const {
+  SnapshotWriter::Status status;
+  if (!_snapshotWriter->getStatus(cubeId, &status)) {
+    out << "Cube " << cubeId << " has not been saved." << endl;
+  } else if (status.running) {
+    out << "Saving cube " << cubeId << " to '" << status.fileName << "': "
+        << status.writtenCells << " of " << status.totalCells
+        << " cells written in " << status.seconds << " s." << endl;
+  } else if (status.failed) {
+    out << "Saving cube " << cubeId << " to '" << status.fileName
+        << "' failed after " << status.seconds << " s." << endl;
+  } else {
+    out << "Saved cube " << cubeId << " to '" << status.fileName << "': "
+        << status.writtenCells << " cells in " << status.seconds << " s, "
+        << status.copiedBytes << " bytes not shared with the server." << endl;
+  }
+}
+
 void AggrEnv::printDimensionInfo() {
   cout << "===================================================================="
        << endl;
@@ -719,6 +1272,15 @@ void AggrEnv::printStorageInfo() {
   }
   t.stop();
   cout << "Full storage iteration time: " << t.format() << endl;
+
+  const ColumnStorage* columns = _cube->getColumnStorage();
+  if (columns) {
+    cout << "Column storage:		" << columns->getMemoryUsage() << " bytes"
+         << endl;
+  } else {
+    cout << "Column storage:		disabled" << endl;
+  }
+  cout << "Area filter:		" << AreaFilter::getInstructionSet() << endl;
   cout << "===================================================================="
        << endl;
 }
@@ -727,11 +1289,15 @@ void AggrEnv::printCellValue(const string& path) {
   cout << "===================================================================="
        << endl;
 
-  IdentifiersType ids;
+  CellKeyType ids;
   // TODO(jmeinke): fix segmentation fault if an element does not exist
   // split the path by commas and add the ids
   vector<string> strIds;
   StringUtils::splitString(path, &strIds, ',');
+  if (strIds.size() > CellKeyType::capacity()) {
+    cout << "Error in cell path '" << path << "'" << endl;
+    return;
+  }
   for (auto it = strIds.begin(); it < strIds.end(); ++it) {
     try {
       ids.push_back(static_cast<IdentifierType>(stol(*it)));
@@ -742,7 +1308,7 @@ void AggrEnv::printCellValue(const string& path) {
   }
 
   try {
-    CellPath cp(&ids);
+    CellPath cp(&ids, _cube->getDimensions());
     cout << "CellPath is: " << cp.toString() << endl;
 
     /* cout << "Elements are: " << endl;
@@ -753,7 +1319,8 @@ void AggrEnv::printCellValue(const string& path) {
     for (size_t cDim = 0; cDim < cubeDimensions.size(); ++cDim) {
       Element* pEl = (*pathElements)[cDim];
       cout << "\tIn '" << cubeDimensions[cDim]->getName() << "':" << endl;
-      cout << "\t -> Element '" << pEl->getName() << "' (Id "
+      cout << "\t -> Element '"
+           << cubeDimensions[cDim]->getElementName(pEl) << "' (Id "
            << pEl->getIdentifier() << ", type " << pEl->getElementType() << ")."
            << endl;
       ElementsWeightType children = cubeDimensions[cDim]->getChildren(pEl);
@@ -762,7 +1329,8 @@ void AggrEnv::printCellValue(const string& path) {
         for (auto chIt = children.begin(); chIt != children.end(); ++chIt) {
           Element* chEl = (*chIt).first;
           double weight = (*chIt).second;
-          cout << "\t\t -> Element '" << chEl->getName() << "' (Id "
+          cout << "\t\t -> Element '"
+               << cubeDimensions[cDim]->getElementName(chEl) << "' (Id "
                << chEl->getIdentifier() << ", type " << chEl->getElementType()
                << ", weight " << weight << ")." << endl;
         }
@@ -893,143 +1461,14 @@ vector<IdentifiersType> AggrEnv::getAreaPathFromString(const string& nPath) {
   return result;
 }
 
-// Computes the areaPath from a cell request
-vector<IdentifiersType> AggrEnv::getCellsFromUrl(const string& path) {
-  // one or more paths can be given like the following:
-  // 0,5,0,2,8,2:0,5,0,3,8,2:...:...
-
-  vector<IdentifiersType> result;
-
-  // split the url parameter into cell paths by :
-  vector<string> cellPaths;
-  StringUtils::splitString(path, &cellPaths, ':');
-
-  const vector<Dimension*> cubeDimensions = *(_cube->getDimensions());
-
-  for (auto path = cellPaths.begin(); path < cellPaths.end(); ++path) {
-    vector<string> elemIds;
-    StringUtils::splitString(*path, &elemIds, ',');
-
-    if (cubeDimensions.size() != elemIds.size()) {
-      throw ErrorException(ErrorException::ERROR_INVALID_COORDINATES,
-                           "wrong number of elements in requested cellpath");
-    }
-
-    IdentifiersType ids;
-    uint32_t dimNum = 0;
-    for (auto el = elemIds.begin(); el < elemIds.end(); ++el, ++dimNum) {
-      Dimension* dim = cubeDimensions[dimNum];
-
-      IdentifierType elemId = static_cast<IdentifierType>(stol(*el));
-      if (dim->lookupElement(elemId) == 0) {
-        std::ostringstream stringStream;
-        stringStream << "requested element " << elemId <<
-            " does not exist in dimension " << (dimNum + 1);
-        throw ErrorException(ErrorException::ERROR_INVALID_COORDINATES,
-                             stringStream.str());
-      }
-      ids.push_back(elemId);
-    }
-
-    result.push_back(ids);
-  }
-
-  return result;
-}
-
-// Computes the areaPath from a cell request
-vector<IdentifiersType> AggrEnv::getAreaPathFromUrl(const string& path) {
-  // an area can be given like the following:
-  // el1:el2:...:el3 from dim1,el1:el2:...:eln from dim2,... 
-  // example: 0,0,0,0:1:2:35:79:325,0:1:2:20:43:65:433,0,8,0
-
-  vector<IdentifiersType> result;
-
-  // split the url parameter into dimension-elements by ,
-  vector<string> elemPaths;
-  StringUtils::splitString(path, &elemPaths, ',');
-
-  const vector<Dimension*> cubeDimensions = *(_cube->getDimensions());
-  if (cubeDimensions.size() != elemPaths.size()) {
-    throw ErrorException(ErrorException::ERROR_INVALID_COORDINATES,
-                         "wrong number of dimensions in requested areapath");
-  }
-
-  uint32_t dimNum = 0;
-  for (auto dimElements = elemPaths.begin(); dimElements < elemPaths.end();
-      ++dimElements, ++dimNum) {
-    if ((*dimElements).empty()) {
-      throw ErrorException(
-          ErrorException::ERROR_INVALID_COORDINATES,
-          "no element ids for at least one dimension in requested areapath");
-    }
-
-    Dimension* dim = cubeDimensions[dimNum];
-    vector<string> elemIds;
-    StringUtils::splitString(*dimElements, &elemIds, ':');
-
-    IdentifiersType ids;
-    for (auto el = elemIds.begin(); el < elemIds.end(); ++el) {
-      IdentifierType elemId = static_cast<IdentifierType>(stol(*el));
-      if (dim->lookupElement(elemId) == 0) {
-        std::ostringstream stringStream;
-        stringStream << "requested element " << elemId << " does not exist";
-        throw ErrorException(ErrorException::ERROR_INVALID_COORDINATES,
-                             stringStream.str());
-        // continue;
-      }
-      ids.push_back(elemId);
-    }
-
-    result.push_back(ids);
-  }
-
-  return result;
-}
-
-// get the cell path combinations from the area elements
-vector<IdentifiersType> AggrEnv::dotPaths(const vector<IdentifiersType>& in) {
-  vector<IdentifiersType> result;
-
-  vector<size_t> counter(in.size(), 0);
-  vector<size_t> sizes;
-
-  for(auto it = in.begin(); it != in.end(); ++it) {
-    assert(it->size() > 0);
-    sizes.push_back(it->size()-1);
-  }
-
-  while (counter != sizes) {
-    // this is the block adding the IdentifiersType with counter offsets
-    IdentifiersType tmp;
-    for(size_t dimN = 0; dimN < in.size(); ++dimN) {
-      tmp.push_back(in.at(dimN).at(counter[dimN]));
-    }
-    result.push_back(tmp);
-
-    for(size_t dimN = 0; dimN < counter.size(); ++dimN) {
-      ++counter[dimN];
-      if (counter[dimN] > sizes[dimN]) {
-        counter[dimN] = 0;
-      } else break;
-    }
-  }
-
-  IdentifiersType tmp;
-  for(size_t dimN = 0; dimN < in.size(); ++dimN) {
-    tmp.push_back(in.at(dimN).at(counter[dimN]));
-  }
-  result.push_back(tmp);
-
-  return result;
-}
-
 // Destructor
 AggrEnv::~AggrEnv() {
+  delete _snapshotWriter;
+  delete _cubeCache;
+  delete _dirLock;
   for (auto i = _dimensions.begin(); i != _dimensions.end(); i++) {
     delete i->second;
   }
   _dimensions.clear();
   _cubes.clear();
-  delete _cube;
 }
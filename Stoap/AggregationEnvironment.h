@@ -40,6 +40,10 @@
 #include "Olap/Dimension.h"
 #include "Exceptions/ParameterException.h"
 
+class CubeCache;
+class DirLock;
+class SnapshotWriter;
+
 // Singleton class
 class AggrEnv {
  public:
@@ -54,6 +58,11 @@ class AggrEnv {
   // Parse the command line arguments.
   // --server-mode, -s   : if set, a pipe for queries will be opened
   // --log-level, -v     : log-level can be [trace|debug|info|warning|error].
+  // --workers, -w       : number of threads answering requests in server mode
+  // --cubes, -c         : 'all' or a comma-separated list of cube ids to load
+  // --lazy, -l          : load cubes on their first request
+  // --memory-budget, -m : MB the loaded cubes may use before LRU eviction
+  // --load-timeout, -L  : seconds a request waits for its cube to load
   void parseCommandLineArguments(int argc, char** argv);
   // FRIEND_TEST(AggregationEnvironmentTest, parseCommandLineArguments);
 
@@ -64,7 +73,8 @@ class AggrEnv {
   // collect information about available cubes
   void collectCubeInfo();
 
-  // if there are multiple cubes, let the user select the cube to load
+  // if there are multiple cubes, let the user select the cube to load. If
+  // cubes were given on the command line, all of them are loaded in parallel.
   void selectAndLoadCube();
 
   // ask the user for an ggregation query or a command
@@ -78,7 +88,8 @@ class AggrEnv {
     return _serverMode;
   }
 
-  // open a pipe to allow enable with other processes
+  // open a pipe to allow enable with other processes. The requests are
+  // answered concurrently by a pool of worker threads.
   void openPipe();
 
   // stop asking the user or handling pipe input
@@ -86,10 +97,22 @@ class AggrEnv {
     _exitRequested = true;
   }
 
+  // the default cube of the CLI
   Cube* getCube() {
     return _cube;
   }
 
+  // minimum number of target area cells for the sort based aggregation,
+  // 0 disables it
+  double getSortThreshold() const {
+    return _sortThreshold;
+  }
+
+  // whether hash lookups and updates are batched and prefetched
+  bool isPrefetchEnabled() const {
+    return _prefetch;
+  }
+
  private:
   // private constructor prevents object creation from the outside of the class
   AggrEnv();
@@ -101,14 +124,44 @@ class AggrEnv {
   // print usage info and exit.
   void printUsageAndExit();
 
+  // the ids of the cubes given on the command line
+  vector<IdentifierType> getCubeList();
+
   // add comments and tests
   void addDimension(Dimension* dimension);
 
+  // load a dimension with its own reader, starting at its section if it was
+  // found in the database file. Executed by the loaders, so errors are
+  // returned in error instead of being thrown.
+  static void loadDimension(Dimension* dimension, const FileName& dbFileName,
+                            const FileReader::SectionsType* sections,
+                            string* error);
+
   // process aggregation query (used in user mode)
   bool processQuery(const string& query);
 
-  // process aggregation request (used in server mode)
-  string handleRequest(const string& request);
+  // the FIFO the answer to a request is written to, either the private FIFO
+  // of the client given by the parameter 'reply' or the shared output FIFO.
+  // Returns false if the request is dropped.
+  bool getReplyPath(const string& request, string* outPath) const;
+
+  // answer a request received on the input FIFO on outPath. The answers on
+  // the shared output FIFO have to be served by a single thread.
+  void serveRequest(const string& request, const string& outPath);
+
+  // answer a request on the FIFO opened as fd and close it
+  void writeAnswer(const string& request, int fd, const string& outPath) const;
+
+  // milliseconds a worker waits for a client to open its private FIFO
+  static const int kReplyTimeout = 10000;
+
+  // milliseconds between two answers on the shared output FIFO
+  static const int kAnswerGap = 10;
+
+  // process aggregation request and write the answer to out (used in server
+  // mode). Only reads the cube and dimensions, so requests can be handled
+  // concurrently.
+  void handleRequest(const string& request, ostream& out) const;
 
   // validate the number of arguments for a given command
   bool checkNumArguments(const string& cmd, int given, int expected);
@@ -116,6 +169,15 @@ class AggrEnv {
   // print information about the cube
   void printCubeInfo();
 
+  // print the memory usage and load time of the loaded cubes
+  void printCubesInfo();
+
+  // start writing a cube to the file (name).csv in the database folder
+  void saveCube(IdentifierType cubeId, const string& name, ostream& out) const;
+
+  // print the progress or the result of the last save of a cube
+  void printSaveStatus(IdentifierType cubeId, ostream& out) const;
+
   // print information about the dimensions
   void printDimensionInfo();
 
@@ -131,14 +193,6 @@ class AggrEnv {
   // construct the area path from a string
   vector<IdentifiersType> getAreaPathFromString(const string& path);
 
-  // construct the area path from a cell value request
-  vector<IdentifiersType> getCellsFromUrl(const string& path);
-
-  // construct the area path from a cell area request
-  vector<IdentifiersType> getAreaPathFromUrl(const string& path);
-
-  vector<IdentifiersType> dotPaths(const vector<IdentifiersType>& in);
-
   // database folder containing database and cube files
   const char* _databasePath;
 
@@ -148,16 +202,60 @@ class AggrEnv {
   // map holding the dimensions
   map<IdentifierType, Dimension*> _dimensions;
 
-  // map holding the cube candidates
+  // map holding the cube candidates, owned by the cube cache once it has been
+  // created. Reloaded cubes are replaced by new versions in the cache only.
   map<IdentifierType, Cube*> _cubes;
 
-  // cube holding the actually used cube
+  // loads the cubes, requests are routed by their cube id
+  CubeCache* _cubeCache;
+
+  // cubes to load, 'all' or a comma-separated list of ids. If empty, a
+  // single cube is selected.
+  string _cubeList;
+
+  // load cubes on their first request
+  bool _lazy;
+
+  // bytes the loaded cubes may use, 0 means unlimited
+  size_t _memoryBudget;
+
+  // seconds a request waits for its cube to load
+  double _loadTimeout;
+
+  // seconds between checks for changed cube files, 0 disables them
+  double _reloadInterval;
+
+  // bytes of a journal which cause a checkpoint, 0 disables the journals
+  size_t _journalSize;
+
+  // locks the database folder while the journals are written
+  DirLock* _dirLock;
+
+  // writes cubes to files in child processes
+  SnapshotWriter* _snapshotWriter;
+
+  // the default cube of the CLI
   Cube* _cube;
   IdentifierType _cubeId;
 
   // decides on whether we want to open a pipe or ask the user
   bool _serverMode;
   bool _exitRequested;
+
+  // target area size from which on the sort based aggregation is used
+  double _sortThreshold;
+
+  // batch and prefetch hash lookups and updates
+  bool _prefetch;
+
+  // copy the cells of the cubes into column storages for the scans
+  bool _columnar;
+
+  // number of worker threads in server mode
+  size_t _numWorkers;
+
+  // time since the last answer on the shared output FIFO was written
+  cpu_timer _fifoOutClosed;
 };
 
 #endif  // STOAP_STOAP_AGGREGATIONENVIRONMENT_H_
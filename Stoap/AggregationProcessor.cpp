@@ -28,6 +28,11 @@
 
 #include "Stoap/AggregationProcessor.h"
 
+#include "Collections/RadixSort.h"
+#include "Engine/AggregationAccumulator.h"
+#include "Engine/CellScanner.h"
+#include "Engine/PathPacker.h"
+#include "InputOutput/ResultWriter.h"
 #include "Olap/DoubleStorage.h"
 #include "Olap/Area.h"
 
@@ -57,14 +62,141 @@ AggregationProcessor::AggregationProcessor(CubeArea* cArea,
   resultStorage = new DoubleStorage();
   resultStorage->m.resize(calcArea->getSize());
 
+  numTargets = 0;
   lastTargets.resize(calcArea->dimCount());
   currentTarget.resize(calcArea->dimCount());
   parentKey.resize(calcArea->dimCount());
   multiDims.resize(calcArea->dimCount());
-  prevSourceKey = IdentifiersType(calcArea->dimCount(), NO_IDENTIFIER );
+  prevSourceKey = CellKeyType(calcArea->dimCount(), NO_IDENTIFIER );
   lastKeyParent = prevSourceKey;
+
+  // select the aggregation kernel for the number of dimensions
+  // and skip all weight computations if there are no weights
+  bool weighted = false;
+  for (auto mapIt = parentMaps.begin(); mapIt != parentMaps.end(); ++mapIt) {
+    weighted = weighted || mapIt->hasWeights();
+  }
+  // use the sort based accumulation for large target areas
+  double sortThreshold = calcArea->getEnv()->getSortThreshold();
+  bool sorted = sortThreshold > 0 && calcArea->getSize() >= sortThreshold
+      && PathPacker::canPack(calcArea);
+  if (calcArea->dimCount() <= kMaxKernelDims) {
+    if (sorted) {
+      kernel = sortKernels[weighted][calcArea->dimCount()];
+    } else if (calcArea->getEnv()->isPrefetchEnabled()) {
+      kernel = prefetchKernels[weighted][calcArea->dimCount()];
+    } else {
+      kernel = hashKernels[weighted][calcArea->dimCount()];
+    }
+  } else {
+    kernel = &AggregationProcessor::aggregateGeneric;
+  }
 }
 
+const size_t AggregationProcessor::kLookupBatchSize;
+
+const AggregationProcessor::KernelType
+AggregationProcessor::hashKernels[2][kMaxKernelDims + 1] = {
+  {
+    &AggregationProcessor::aggregateGeneric,
+    &AggregationProcessor::aggregateKernel<1, false, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<2, false, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<3, false, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<4, false, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<5, false, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<6, false, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<7, false, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<8, false, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<9, false, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<10, false, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<11, false, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<12, false, HashAccumulator>
+  },
+  {
+    &AggregationProcessor::aggregateGeneric,
+    &AggregationProcessor::aggregateKernel<1, true, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<2, true, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<3, true, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<4, true, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<5, true, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<6, true, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<7, true, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<8, true, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<9, true, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<10, true, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<11, true, HashAccumulator>,
+    &AggregationProcessor::aggregateKernel<12, true, HashAccumulator>
+  }
+};
+
+const AggregationProcessor::KernelType
+AggregationProcessor::prefetchKernels[2][kMaxKernelDims + 1] = {
+  {
+    &AggregationProcessor::aggregateGeneric,
+    &AggregationProcessor::aggregateKernel<1, false, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<2, false, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<3, false, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<4, false, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<5, false, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<6, false, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<7, false, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<8, false, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<9, false, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<10, false, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<11, false, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<12, false, PrefetchAccumulator>
+  },
+  {
+    &AggregationProcessor::aggregateGeneric,
+    &AggregationProcessor::aggregateKernel<1, true, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<2, true, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<3, true, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<4, true, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<5, true, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<6, true, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<7, true, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<8, true, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<9, true, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<10, true, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<11, true, PrefetchAccumulator>,
+    &AggregationProcessor::aggregateKernel<12, true, PrefetchAccumulator>
+  }
+};
+
+const AggregationProcessor::KernelType
+AggregationProcessor::sortKernels[2][kMaxKernelDims + 1] = {
+  {
+    &AggregationProcessor::aggregateGeneric,
+    &AggregationProcessor::aggregateKernel<1, false, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<2, false, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<3, false, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<4, false, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<5, false, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<6, false, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<7, false, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<8, false, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<9, false, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<10, false, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<11, false, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<12, false, SortAccumulator>
+  },
+  {
+    &AggregationProcessor::aggregateGeneric,
+    &AggregationProcessor::aggregateKernel<1, true, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<2, true, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<3, true, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<4, true, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<5, true, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<6, true, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<7, true, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<8, true, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<9, true, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<10, true, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<11, true, SortAccumulator>,
+    &AggregationProcessor::aggregateKernel<12, true, SortAccumulator>
+  }
+};
+
 /**
  * @brief this is the place where the aggregation is performed
  */
@@ -113,19 +245,188 @@ void AggregationProcessor::aggregate() {
   LOG(INFO) << "Starting source-based aggregation...";
 
   // iterate entries of the storage map
+  size_t numCells = (this->*kernel)(storage);
+
+  t.stop();
+  LOG(INFO)<< "Aggregation time: " << t.format();
+  if (numCells) {
+    LOG(INFO)<< "Aggregated " << numCells << " source cells ("
+        << t.elapsed().wall / numCells << " ns per cell).";
+  }
+  if (numTargets) {
+    LOG(INFO)<< "Emitted " << numTargets << " target values ("
+        << t.elapsed().wall / numTargets << " ns per target).";
+  }
+}
+
+size_t AggregationProcessor::aggregateGeneric(DoubleStorage* storage) {
+  Cube* cube = calcArea->getCube();
+  size_t numCells = 0;
   for (auto srcIt = storage->m.begin(); srcIt != storage->m.end(); ++srcIt) {
     // if (getNumTargets(srcIt->first) == 0) continue;
     if (!srcArea->isInArea(&(srcIt->first))) continue;
+    // skip the base cells which are replaced or removed by the changes
+    if (cube->hasChanges() && cube->getValue(&srcIt->first) != &srcIt->second) {
+      continue;
+    }
     aggregateCell(srcIt->first, srcIt->second);
+    ++numCells;
   }
 
-  LOG(INFO)<< "Aggregation time: " << t.format();
+  // the changed cells, unless a newer delta segment replaced them
+  CellKeyType key;
+  for (size_t i = 0; i < cube->getDeltaCount(); i++) {
+    const ColumnStorage* changes = cube->getDelta(i)->getColumns();
+    for (size_t row = 0; row < changes->size(); ++row) {
+      changes->getKey(row, &key);
+      if (!srcArea->isInArea(&key) || cube->isReplaced(i, &key)) continue;
+      aggregateCell(key, changes->getValues()[row]);
+      ++numCells;
+    }
+  }
+  return numCells;
+}
+
+// Same algorithm as aggregateCell(), but all per-dimension state lives in
+// fixed-size arrays and the common fan-out shapes (no, one or two dimensions
+// with multiple targets) get their own loops instead of the generic odometer.
+// Without WEIGHTED every target receives the plain source value.
+// The source cells inside the source area are read block-wise by a
+// CellScanner, from the column storage of the cube if it has one.
+template<size_t DIMS, bool WEIGHTED, class ACCUMULATOR>
+size_t AggregationProcessor::aggregateKernel(DoubleStorage* storage) {
+  // the base cells are scanned first, then the changed cells of the cube
+  CellScanner scanner(calcArea->getCube(), srcArea);
+  const IdentifierType* columns[DIMS];
+  const double* values;
+  const uint32_t* selection;
+  size_t selected;
+
+  ACCUMULATOR accumulator(calcArea, resultStorage);
+  const AggregationMap* maps[DIMS];
+  IdentifierType prevKey[DIMS];
+  AggregationMap::TargetReader targets[DIMS];
+  AggregationMap::TargetReader current[DIMS];
+  size_t multi[DIMS];
+
+  for (size_t dim = 0; dim < DIMS; dim++) {
+    maps[dim] = &parentMaps[dim];
+    prevKey[dim] = NO_IDENTIFIER;
+  }
+
+  size_t numCells = 0;
+  while (scanner.next(columns, &values, &selection, &selected)) {
+    for (size_t s = 0; s < selected; s++) {
+      const size_t cell = selection[s];
+      ++numCells;
+
+      // fetch the targets of each dimension, reuse them if the id is
+      // unchanged
+      double fixedWeight = 1;
+      size_t multiDimCount = 0;
+      for (size_t dim = 0; dim < DIMS; dim++) {
+        const IdentifierType id = columns[dim][cell];
+        if (id != prevKey[dim]) {
+          prevKey[dim] = id;
+          targets[dim] = maps[dim]->getTargets(id);
+        }
+        parentKey[dim] = *targets[dim];
+        if (targets[dim].size() > 1) {
+          multi[multiDimCount++] = dim;
+        } else if (WEIGHTED) {
+          fixedWeight *= targets[dim].getWeight();
+        }
+      }
+
+      const double value = values[cell];
+      switch (multiDimCount) {
+        case 0:
+          accumulator.add(parentKey, WEIGHTED ? fixedWeight * value : value);
+          break;
+
+        case 1: {
+          const size_t d0 = multi[0];
+          for (AggregationMap::TargetReader t0 = targets[d0]; !t0.end();
+              ++t0) {
+            parentKey[d0] = *t0;
+            if (WEIGHTED) {
+              double weight = fixedWeight * t0.getWeight();
+              accumulator.add(parentKey, weight * value);
+            } else {
+              accumulator.add(parentKey, value);
+            }
+          }
+          break;
+        }
+
+        case 2: {
+          const size_t d0 = multi[0];
+          const size_t d1 = multi[1];
+          for (AggregationMap::TargetReader t0 = targets[d0]; !t0.end();
+              ++t0) {
+            parentKey[d0] = *t0;
+            const double weight0 =
+                WEIGHTED ? fixedWeight * t0.getWeight() : 1;
+            for (AggregationMap::TargetReader t1 = targets[d1]; !t1.end();
+                ++t1) {
+              parentKey[d1] = *t1;
+              if (WEIGHTED) {
+                double weight = weight0 * t1.getWeight();
+                accumulator.add(parentKey, weight * value);
+              } else {
+                accumulator.add(parentKey, value);
+              }
+            }
+          }
+          break;
+        }
+
+        default: {
+          for (size_t m = 0; m < multiDimCount; m++) {
+            current[multi[m]] = targets[multi[m]];
+          }
+          size_t changeMultiDim;
+          do {
+            if (WEIGHTED) {
+              double weight = fixedWeight;
+              for (size_t m = 0; m < multiDimCount; m++) {
+                weight *= current[multi[m]].getWeight();
+              }
+              accumulator.add(parentKey, weight * value);
+            } else {
+              accumulator.add(parentKey, value);
+            }
+
+            // advance to the next combination of parents
+            changeMultiDim = multiDimCount - 1;
+            while (changeMultiDim < multiDimCount) {
+              AggregationMap::TargetReader &target =
+                  current[multi[changeMultiDim]];
+              ++target;
+              if (target.end()) {
+                target.reset();
+                parentKey[multi[changeMultiDim]] = *target;
+                changeMultiDim--;
+              } else {
+                parentKey[multi[changeMultiDim]] = *target;
+                break;
+              }
+            }
+          } while (changeMultiDim < multiDimCount);
+          break;
+        }
+      }
+    }
+  }
+  accumulator.flush();
+  numTargets = accumulator.getCount();
+  return numCells;
 }
 
 // check if the key has targets in the aggregation map
-size_t AggregationProcessor::getNumTargets(const IdentifiersType &key) {
+size_t AggregationProcessor::getNumTargets(const CellKeyType &key) {
   size_t numTargets = 1;
-  IdentifiersType::const_iterator elemId = key.begin();
+  CellKeyType::const_iterator elemId = key.begin();
   for (size_t dim = 0; dim < calcArea->dimCount(); dim++, ++elemId) {
     const IdentifierType sourceId = *elemId;
     if (sourceId < *(parentMaps[dim].getMinBaseId()) || sourceId > *(parentMaps[dim].getMaxBaseId())) {
@@ -136,7 +437,7 @@ size_t AggregationProcessor::getNumTargets(const IdentifiersType &key) {
   return numTargets;
 }
 
-void AggregationProcessor::aggregateCell(const IdentifiersType &key,
+void AggregationProcessor::aggregateCell(const CellKeyType &key,
                                          const double value) {
   double fixedWeight;
   size_t multiDimCount;
@@ -157,7 +458,7 @@ void AggregationProcessor::aggregateCell(const IdentifiersType &key,
   } while (changeMultiDim < multiDimCount);
 }
 
-void AggregationProcessor::initParentKey(const IdentifiersType &key,
+void AggregationProcessor::initParentKey(const CellKeyType &key,
                                          size_t &multiDimCount,
                                          double *fixedWeight) {
   if (fixedWeight) {
@@ -167,8 +468,8 @@ void AggregationProcessor::initParentKey(const IdentifiersType &key,
   multiDimCount = 0;
   vector<AggregationMap::TargetReader>::iterator lastTarget =
       lastTargets.begin();
-  IdentifiersType::iterator prevSourceKeyIt = prevSourceKey.begin();
-  IdentifiersType::const_iterator elemId = key.begin();
+  CellKeyType::iterator prevSourceKeyIt = prevSourceKey.begin();
+  CellKeyType::const_iterator elemId = key.begin();
   for (size_t dim = 0; dim < calcArea->dimCount();
       dim++, ++lastTarget, ++prevSourceKeyIt, ++elemId) {
     AggregationMap::TargetReader targets;
@@ -229,12 +530,12 @@ void AggregationProcessor::print() {
   cout << setprecision(numeric_limits<double>::digits10);
   cout << "Type:\tPath:\tValue:" << endl;
 
-  DoubleStorage* storage = calcArea->getCube()->getStorage();
+  Cube* cube = calcArea->getCube();
 
   for (auto pathIt = calcArea->pathBegin(); pathIt != calcArea->pathEnd();
       ++pathIt) {
 
-    CellPath myPath(&(*pathIt));
+    CellPath myPath(&(*pathIt), cube->getDimensions());
     if (!myPath.isBase()) {
       double* value = resultStorage->getValue(myPath.getPathIdentifier());
 
@@ -246,7 +547,7 @@ void AggregationProcessor::print() {
       }
     } else {
       cout << "Base\t" << myPath.toString() << ":\t";
-      double* value = storage->getValue(myPath.getPathIdentifier());
+      double* value = cube->getValue(myPath.getPathIdentifier());
       if ((value) == NULL) {
         cout << "error (cubeStorage empty)" << endl;
       } else {
@@ -256,58 +557,178 @@ void AggregationProcessor::print() {
   }
 }
 
-string AggregationProcessor::result(const vector<IdentifiersType>& req,
+string AggregationProcessor::result(const vector<CellKeyType>& req,
                                     bool addPath, bool addZero) {
-  DoubleStorage* storage = calcArea->getCube()->getStorage();
-
   stringstream ss;
-  ss << setprecision(numeric_limits<double>::digits10);
+  TextResultWriter writer(&ss, addPath, addZero);
 
   if (!req.empty()) {
-    for (auto pathIt = req.begin(); pathIt != req.end(); ++pathIt) {
-      CellPath myPath(&(*pathIt));
-
-      ss << "1;";  // cell type (numeric)
-      double* value;
-      if (!myPath.isBase()) {
-        value = resultStorage->getValue(&(*pathIt));
-      } else {
-        value = storage->getValue(&(*pathIt));
+    streamResult(&writer, req);
+  } else {
+    CellKeyType batch[kLookupBatchSize];
+    double* values[kLookupBatchSize];
+    size_t size = 0;
+    for (auto pathIt = calcArea->pathBegin(); pathIt != calcArea->pathEnd();
+        ++pathIt) {
+      batch[size] = *pathIt;
+      if (++size == kLookupBatchSize) {
+        lookupBatch(batch, size, values);
+        writer.add(batch, values, size);
+        size = 0;
       }
-      if ((value) == NULL) {
-        ss << "0;;";  // not found
-      } else {
-        ss << "1;" << *value << ";";  // found + value
+    }
+    lookupBatch(batch, size, values);
+    writer.add(batch, values, size);
+  }
+  writer.finish();
+  return ss.str();
+}
+
+void AggregationProcessor::streamResult(ResultWriter* writer,
+                                        const vector<CellKeyType>& paths) {
+  double* values[kLookupBatchSize];
+  for (size_t i = 0; i < paths.size(); i += kLookupBatchSize) {
+    size_t size = min(kLookupBatchSize, paths.size() - i);
+    lookupBatch(&paths[i], size, values);
+    writer->add(&paths[i], values, size);
+  }
+}
+
+void AggregationProcessor::streamResult(ResultWriter* writer,
+                                        const vector<IdentifiersType>& area) {
+  for (auto it = area.begin(); it != area.end(); ++it) {
+    if (it->empty()) {
+      return;
+    }
+  }
+
+  vector<size_t> counter(area.size(), 0);
+  CellKeyType batch[kLookupBatchSize];
+  double* values[kLookupBatchSize];
+  size_t size = 0;
+  bool done = false;
+
+  while (!done) {
+    CellKeyType& path = batch[size];
+    path.clear();
+    for (size_t dimN = 0; dimN < area.size(); ++dimN) {
+      path.push_back(area[dimN][counter[dimN]]);
+    }
+
+    // advance the counter, the first dimension changes fastest
+    done = true;
+    for (size_t dimN = 0; dimN < counter.size(); ++dimN) {
+      if (++counter[dimN] < area[dimN].size()) {
+        done = false;
+        break;
       }
+      counter[dimN] = 0;
+    }
+
+    if (++size == kLookupBatchSize || done) {
+      lookupBatch(batch, size, values);
+      writer->add(batch, values, size);
+      size = 0;
+    }
+  }
+}
 
-      if (addPath) ss << myPath.toString() << ";";  // path
-      if (addZero) ss  << ";0;";  // zero
-      ss << endl;
+// Every filled cell of the area has a value in the result storage, base
+// cells included, as each base element is its own base element. Only the
+// aggregation of a single base cell is skipped in aggregate().
+void AggregationProcessor::streamSparseResult(ResultWriter* writer) {
+  // the paths are sorted as packed positions if the area is small enough
+  const bool packed = PathPacker::canPack(calcArea);
+  PathPacker packer(calcArea);
+  vector<uint64_t> positions;
+  vector<CellKeyType> paths;
+
+  auto collect = [&](const CellKeyType& path) {
+    if (packed) {
+      positions.push_back(packer.pack(path));
+    } else {
+      paths.push_back(path);
     }
+  };
+
+  if (calcArea->getSize() == 1 && resultStorage->m.empty()) {
+    collect(*calcArea->pathBegin());
   } else {
-    for (auto pathIt = calcArea->pathBegin(); pathIt != calcArea->pathEnd();
-        ++pathIt) {
-      CellPath myPath(&(*pathIt));
+    if (packed) {
+      positions.reserve(resultStorage->m.size());
+    } else {
+      paths.reserve(resultStorage->m.size());
+    }
+    for (auto it = resultStorage->m.begin(); it != resultStorage->m.end();
+        ++it) {
+      collect(it->first);
+    }
+  }
+
+  if (packed) {
+    vector<uint64_t> buffer;
+    radixSort(positions, buffer, [](uint64_t position) {return position;});
+  } else {
+    sort(paths.begin(), paths.end());
+  }
 
-      ss << "1;";  // cell type (numeric)
-      double* value;
-      if (!myPath.isBase()) {
-        value = resultStorage->getValue(&(*pathIt));
+  CellKeyType batch[kLookupBatchSize];
+  double* values[kLookupBatchSize];
+  size_t numPaths = packed ? positions.size() : paths.size();
+  for (size_t i = 0; i < numPaths; i += kLookupBatchSize) {
+    size_t size = min(kLookupBatchSize, numPaths - i);
+    for (size_t j = 0; j < size; j++) {
+      if (packed) {
+        packer.unpack(positions[i + j], &batch[j]);
       } else {
-        value = storage->getValue(&(*pathIt));
+        batch[j] = paths[i + j];
       }
-      if ((value) == NULL) {
-        ss << "0;;";  // not found
-      } else {
-        ss << "1;" << *value << ";";  // found + value
+    }
+    lookupBatch(batch, size, values);
+
+    // skip the cells which were not found
+    size_t found = 0;
+    for (size_t j = 0; j < size; j++) {
+      if (values[j] != NULL) {
+        batch[found] = batch[j];
+        values[found++] = values[j];
       }
+    }
+    writer->add(batch, values, found);
+  }
+}
+
+// The buckets of all paths of the batch are prefetched before the first
+// value is looked up, see PrefetchAccumulator.
+void AggregationProcessor::lookupBatch(const CellKeyType* paths, size_t count,
+                                       double** values) {
+  Cube* cube = calcArea->getCube();
+  DoubleStorage* cubeStorage = cube->getStorage();
+  const vector<Dimension*>* dimensions = cube->getDimensions();
+  bool prefetch = calcArea->getEnv()->isPrefetchEnabled();
+
+  // base cells of a cube with changes are looked up by the cube, which
+  // checks the changes first
+  DoubleStorage* storages[kLookupBatchSize];
+  for (size_t i = 0; i < count; i++) {
+    CellPath myPath(&paths[i], dimensions);
+    if (!myPath.isBase()) {
+      storages[i] = resultStorage;
+    } else {
+      storages[i] = cube->hasChanges() ? NULL : cubeStorage;
+    }
+    if (prefetch && storages[i] != NULL) {
+      storages[i]->prefetchBucket(storages[i]->getBucket(&paths[i]));
+    }
+  }
 
-      if (addPath) ss << myPath.toString() << ";";  // path
-      if (addZero) ss << ";0;";  // zero
-      ss << endl;
+  for (size_t i = 0; i < count; i++) {
+    if (storages[i] != NULL) {
+      values[i] = storages[i]->getValue(&paths[i]);
+    } else {
+      values[i] = cube->getValue(&paths[i]);
     }
   }
-  return ss.str();
 }
 
 /**
@@ -32,6 +32,8 @@
 #include "Engine/AggregationMap.h"
 #include "Olap/DoubleStorage.h"
 
+class ResultWriter;
+
 class AggregationProcessor {
  public:
   enum AggregationType {
@@ -47,15 +49,57 @@ class AggregationProcessor {
 
   void aggregate();
   void print();
-  string result(const vector<IdentifiersType>& request, bool addPath = false, bool addZero = false);
+  string result(const vector<CellKeyType>& request, bool addPath = false, bool addZero = false);
+
+  // add the values of the paths to the writer in request order
+  void streamResult(ResultWriter* writer, const vector<CellKeyType>& paths);
+
+  // add the values of all combinations of the area elements to the writer.
+  // The paths are enumerated in request order with the first dimension
+  // changing fastest, without materializing them.
+  void streamResult(ResultWriter* writer, const vector<IdentifiersType>& area);
+
+  // add the values of the filled cells of the area to the writer, sorted by
+  // path with the first dimension as most significant. Empty cells and
+  // duplicate elements of the request are skipped.
+  void streamSparseResult(ResultWriter* writer);
 
  protected:
-  void aggregateCell(const IdentifiersType &key, const double value);
-  size_t getNumTargets(const IdentifiersType &key);
-  void initParentKey(const IdentifiersType &key, size_t &multiDimCount,
+  void aggregateCell(const CellKeyType &key, const double value);
+  size_t getNumTargets(const CellKeyType &key);
+  void initParentKey(const CellKeyType &key, size_t &multiDimCount,
                      double *fixedWeight);
   void nextParentKey(size_t multiDimCount, size_t &changeMultiDim);
 
+  // look up the values of up to kLookupBatchSize paths, NULL if not found
+  void lookupBatch(const CellKeyType* paths, size_t count, double** values);
+  static const size_t kLookupBatchSize = 16;
+
+  // aggregation kernel specialized for a fixed number of dimensions,
+  // returns the number of aggregated source cells. The unweighted variant
+  // is used if none of the aggregation maps has weights other than 1.0.
+  // The values are added to the result by a Hash- or PrefetchAccumulator
+  // or, for large target areas, a SortAccumulator.
+  template<size_t DIMS, bool WEIGHTED, class ACCUMULATOR>
+  size_t aggregateKernel(DoubleStorage* storage);
+
+  // fallback for cubes with more than kMaxKernelDims dimensions
+  size_t aggregateGeneric(DoubleStorage* storage);
+
+  typedef size_t (AggregationProcessor::*KernelType)(DoubleStorage* storage);
+
+  // kernels are instantiated for 1 to kMaxKernelDims dimensions
+  static const size_t kMaxKernelDims = 12;
+  static const KernelType hashKernels[2][kMaxKernelDims + 1];
+  static const KernelType prefetchKernels[2][kMaxKernelDims + 1];
+  static const KernelType sortKernels[2][kMaxKernelDims + 1];
+
+  // the kernel selected for the area to be calculated
+  KernelType kernel;
+
+  // number of values added to the result by the kernel
+  size_t numTargets;
+
   // the area of relevant source cells
   CubeArea* srcArea;
 
@@ -69,11 +113,11 @@ class AggregationProcessor {
   DoubleStorage* resultStorage;
   vector<size_t> resultSize;
 
-  IdentifiersType prevSourceKey;
-  IdentifiersType lastKeyParent;
+  CellKeyType prevSourceKey;
+  CellKeyType lastKeyParent;
   vector<AggregationMap::TargetReader> lastTargets;
   vector<AggregationMap::TargetReader> currentTarget;
-  IdentifiersType parentKey;
+  CellKeyType parentKey;
   IdentifiersType multiDims;
   AggregationMaps parentMaps;
 };
@@ -0,0 +1,618 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#include "Stoap/CubeCache.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread_time.hpp>
+
+#include "Collections/StringUtils.h"
+#include "Exceptions/ErrorException.h"
+#include "InputOutput/FileUtils.h"
+
+CubeCache::CubeCache(const map<IdentifierType, Cube*>& cubes,
+                     size_t numLoaders, size_t memoryBudget,
+                     double loadTimeout, double reloadInterval,
+                     size_t journalSize)
+    : useCounter(0),
+      memoryBudget(memoryBudget),
+      loadTimeout(loadTimeout),
+      reloadInterval(reloadInterval),
+      journalSize(journalSize),
+      watcher(NULL),
+      loaders(numLoaders) {
+  for (auto it = cubes.begin(); it != cubes.end(); ++it) {
+    Entry& entry = entries[it->first];
+    entry.cube.reset(it->second);
+    entry.state = it->second->isLoaded() ? LOADED : UNLOADED;
+    entry.reloading = false;
+    entry.compacting = false;
+    entry.checkpointing = false;
+    entry.pins = 0;
+    entry.lastUse = 0;
+    if (journalSize > 0) {
+      const FileName* fileName = it->second->getFileName();
+      entry.journal.reset(new Journal(FileName(*fileName, "journal"),
+                                      *fileName,
+                                      it->second->getDimensions()->size()));
+    }
+  }
+  if (reloadInterval > 0) {
+    watcher = new boost::thread(boost::bind(&CubeCache::watchFiles, this));
+  }
+}
+
+CubeCache::~CubeCache() {
+  // the watcher submits reloads, so it is stopped before the loaders
+  if (watcher != NULL) {
+    watcher->interrupt();
+    watcher->join();
+    delete watcher;
+  }
+}
+
+void CubeCache::prefetch(IdentifierType identifier) {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  auto it = entries.find(identifier);
+  if (it != entries.end() && it->second.state == UNLOADED) {
+    startLoad(identifier, &it->second);
+  }
+}
+
+void CubeCache::waitForLoads() {
+  boost::unique_lock<boost::mutex> lock(mutex);
+  while (true) {
+    bool loading = false;
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      loading = loading || it->second.state == LOADING;
+    }
+    if (!loading) {
+      return;
+    }
+    stateChanged.wait(lock);
+  }
+}
+
+boost::shared_ptr<Cube> CubeCache::acquire(IdentifierType identifier) {
+  boost::unique_lock<boost::mutex> lock(mutex);
+  auto it = entries.find(identifier);
+  if (it == entries.end()) {
+    throw ErrorException(ErrorException::ERROR_CUBE_NOT_FOUND,
+                         "cube " + StringUtils::convertToString(identifier)
+                             + " does not exist");
+  }
+
+  // the cube may be evicted again before this thread wakes up, so it is
+  // loaded as often as needed until the timeout
+  Entry& entry = it->second;
+  boost::system_time deadline = boost::get_system_time()
+      + boost::posix_time::milliseconds(
+          static_cast<int64_t>(loadTimeout * 1000));
+  while (entry.state != LOADED) {
+    if (entry.state == FAILED) {
+      throw ErrorException(ErrorException::ERROR_CUBE_NOT_LOADED,
+                           "cube '" + entry.cube->getName()
+                               + "' could not be loaded");
+    } else if (entry.state == UNLOADED) {
+      startLoad(identifier, &entry);
+    }
+    if (!stateChanged.timed_wait(lock, deadline)
+        && entry.state == LOADING) {
+      throw ErrorException(ErrorException::ERROR_CUBE_NOT_LOADED,
+                           "cube '" + entry.cube->getName()
+                               + "' is still being loaded, try again later");
+    }
+  }
+
+  entry.pins++;
+  entry.lastUse = ++useCounter;
+  return entry.cube;
+}
+
+void CubeCache::release(IdentifierType identifier) {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  entries.find(identifier)->second.pins--;
+  evict(NULL);
+}
+
+void CubeCache::reload(IdentifierType identifier) {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  auto it = entries.find(identifier);
+  if (it == entries.end()) {
+    throw ErrorException(ErrorException::ERROR_CUBE_NOT_FOUND,
+                         "cube " + StringUtils::convertToString(identifier)
+                             + " does not exist");
+  }
+
+  // a cube being loaded may have read the old file, so it is reloaded as
+  // soon as it is loaded. A cube being written to its file is reloaded
+  // afterwards.
+  Entry& entry = it->second;
+  if (entry.state == LOADED && !entry.reloading && !entry.checkpointing) {
+    loaders.submit(boost::bind(&CubeCache::loadVersion, this, identifier));
+  } else if (entry.state == FAILED) {
+    entry.state = UNLOADED;
+  }
+  entry.reloading = entry.state == LOADED || entry.state == LOADING;
+}
+
+Cube::DeltaCounts CubeCache::changeCube(
+    IdentifierType identifier, const vector<pair<CellKeyType, double> >& cells,
+    Cube::DeltaMode mode) {
+  Cube::DeltaCounts counts;
+  Journal* journal = NULL;
+  uint64_t sequence = 0;
+  boost::shared_ptr<Cube> current;
+  {
+    // the cube is loaded before the change lock is taken, so the changes of
+    // other cubes do not wait for the load. The entries are not added or
+    // removed after construction.
+    Pin pin(this, identifier);
+    boost::lock_guard<boost::mutex> changeLock(
+        entries.find(identifier)->second.changeMutex);
+    {
+      boost::lock_guard<boost::mutex> lock(mutex);
+      current = entries.find(identifier)->second.cube;
+    }
+
+    // the new version shares the dimensions with the current one
+    vector<Dimension*> dimensions = *current->getDimensions();
+    boost::shared_ptr<Cube> version(
+        new Cube(current->getName(), *current->getFileName(), &dimensions));
+    version->loadCube(*current);
+    counts = version->applyCells(cells, mode);
+
+    boost::lock_guard<boost::mutex> lock(mutex);
+    Entry& entry = entries.find(identifier)->second;
+    if (entry.reloading || entry.cube != current) {
+      throw ErrorException(ErrorException::ERROR_CUBE_NOT_LOADED,
+                           "cube '" + current->getName()
+                               + "' is being reloaded, try again later");
+    }
+
+    // the records are appended in the order of the versions, but written
+    // after the lock is released, so that the changes of several requests
+    // are written together
+    if (entry.journal) {
+      journal = entry.journal.get();
+      sequence = journal->append(mode, cells);
+    }
+    entry.cube = version;
+    entry.lastUse = ++useCounter;
+
+    // the compaction and the checkpoint keep the cube pinned until they have
+    // finished
+    size_t numChanges = version->getChangeCount();
+    if (!entry.compacting && numChanges > kMinCompactionCells
+        && numChanges * kCompactionRatio > version->sizeFilledCells()) {
+      entry.compacting = true;
+      entry.pins++;
+      loaders.submit(boost::bind(&CubeCache::compact, this, identifier));
+    }
+    if (journal != NULL && !entry.checkpointing
+        && journal->getSize() > journalSize) {
+      entry.checkpointing = true;
+      entry.pins++;
+      loaders.submit(boost::bind(&CubeCache::checkpoint, this, identifier));
+    }
+    evict(&entry);
+  }
+
+  // the change is visible to other requests already, but only acknowledged
+  // once it is on the disk
+  if (journal != NULL) {
+    try {
+      journal->sync(sequence);
+    } catch (const ErrorException&) {
+      // the records from the first one which failed are not in the journal,
+      // so the request which wrote it swaps in the version it started from.
+      // The journal is opened again by the reload.
+      {
+        boost::lock_guard<boost::mutex> changeLock(
+            entries.find(identifier)->second.changeMutex);
+        boost::lock_guard<boost::mutex> lock(mutex);
+        Entry& entry = entries.find(identifier)->second;
+        if (entry.state == LOADED
+            && journal->getDurableSequence() + 1 == sequence) {
+          LOG(WARNING) << "The changes of cube '" << current->getName()
+                       << "' which were not written to its journal are "
+                       << "undone.";
+          entry.cube = current;
+        }
+      }
+      reload(identifier);
+      throw;
+    }
+  }
+  return counts;
+}
+
+void CubeCache::compact(IdentifierType identifier) {
+  boost::shared_ptr<Cube> current;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    current = entries.find(identifier)->second.cube;
+  }
+
+  cpu_timer timer;
+  vector<Dimension*> dimensions = *current->getDimensions();
+  boost::shared_ptr<Cube> version(
+      new Cube(current->getName(), *current->getFileName(), &dimensions));
+  version->loadCube(*current);
+  size_t numChanges = version->getChangeCount();
+  version->compactChanges();
+
+  {
+    // no cells are written until the compacted version is swapped in
+    boost::lock_guard<boost::mutex> changeLock(
+        entries.find(identifier)->second.changeMutex);
+    boost::shared_ptr<Cube> latest;
+    {
+      boost::lock_guard<boost::mutex> lock(mutex);
+      latest = entries.find(identifier)->second.cube;
+    }
+
+    // the cells written meanwhile are applied to the compacted version,
+    // unless the cube was reloaded
+    bool compacted = latest->getStorage() == current->getStorage();
+    if (compacted && latest != current) {
+      vector<pair<CellKeyType, double> > cells;
+      vector<pair<CellKeyType, double> > cleared;
+      latest->getChangesSince(current.get(), &cells, &cleared);
+      version->applyCells(cells, Cube::DELTA_SET);
+      version->applyCells(cleared, Cube::DELTA_CLEAR);
+    }
+
+    boost::lock_guard<boost::mutex> lock(mutex);
+    Entry& entry = entries.find(identifier)->second;
+    entry.compacting = false;
+    if (compacted && entry.cube == latest && !entry.reloading) {
+      version->setFileTime(latest->getFileTime());
+      entry.cube = version;
+      LOG(INFO) << "Merged " << numChanges << " changed cells of cube '"
+                << version->getName() << "' in "
+                << timer.elapsed().wall / 1e9 << " s.";
+    }
+  }
+  release(identifier);
+}
+
+// applies a record of the journal to the values and the cleared cells
+// collected so far, which hide the values of the cube
+static void foldRecord(Cube* cube, DoubleStorage* values,
+                       DoubleStorage* cleared, uint32_t mode,
+                       const Journal::Cells& cells) {
+  if (mode > Cube::DELTA_CLEAR) {
+    throw ErrorException(ErrorException::ERROR_CORRUPT_FILE,
+                         "unknown change in journal");
+  }
+
+  for (auto it = cells.begin(); it != cells.end(); ++it) {
+    const CellKeyType* key = &it->first;
+    double* value = values->getValue(key);
+    if (mode == Cube::DELTA_CLEAR) {
+      values->removeValue(key);
+      cleared->setValue(key, 0);
+      continue;
+    }
+
+    // the same arithmetic as Cube::applyCells, so the values are identical
+    if (value == NULL && cleared->getValue(key) == NULL) {
+      value = cube->getValue(key);
+    }
+    if (mode == Cube::DELTA_ADD && value != NULL) {
+      values->setValue(key, *value + it->second);
+    } else {
+      values->setValue(key, it->second);
+    }
+  }
+}
+
+void CubeCache::replayJournal(Journal* journal, Cube* cube) {
+  // the records are folded into one batch of values and one of cleared
+  // cells, which are applied like a delta
+  cpu_timer timer;
+  DoubleStorage values;
+  DoubleStorage cleared;
+  size_t records = journal->open(boost::bind(&foldRecord, cube, &values,
+                                             &cleared, _1, _2));
+  if (records == 0) {
+    return;
+  }
+
+  vector<pair<CellKeyType, double> > cells;
+  vector<pair<CellKeyType, double> > clearedCells;
+  cells.reserve(values.m.size());
+  for (auto it = values.m.begin(); it != values.m.end(); ++it) {
+    cells.push_back(make_pair(it->first, it->second));
+  }
+  for (auto it = cleared.m.begin(); it != cleared.m.end(); ++it) {
+    if (values.getValue(&it->first) == NULL) {
+      clearedCells.push_back(make_pair(it->first, 0.0));
+    }
+  }
+  cube->applyCells(cells, Cube::DELTA_SET);
+  cube->applyCells(clearedCells, Cube::DELTA_CLEAR);
+  cube->compactChanges();
+  LOG(INFO) << "Replayed " << records << " changes of cube '"
+            << cube->getName() << "' from its journal in "
+            << timer.elapsed().wall / 1e9 << " s.";
+}
+
+void CubeCache::checkpoint(IdentifierType identifier) {
+  boost::shared_ptr<Cube> current;
+  Journal* journal;
+  uint64_t offset;
+  {
+    // the version holds the changes of the records before the offset
+    Entry& entry = entries.find(identifier)->second;
+    boost::lock_guard<boost::mutex> changeLock(entry.changeMutex);
+    boost::lock_guard<boost::mutex> lock(mutex);
+    current = entry.cube;
+    journal = entry.journal.get();
+    offset = journal->getSize();
+  }
+
+  cpu_timer timer;
+  const FileName* fileName = current->getFileName();
+  try {
+    current->saveCube(identifier, FileName(*fileName, "tmp"));
+
+    // no changes are appended until the journal belongs to the new file
+    boost::lock_guard<boost::mutex> changeLock(
+        entries.find(identifier)->second.changeMutex);
+    journal->checkpoint(offset, FileName(*fileName, "tmp"));
+
+    // the new file is not reloaded by the watcher
+    time_t fileTime = FileUtils::getModificationTime(*fileName);
+    boost::lock_guard<boost::mutex> lock(mutex);
+    entries.find(identifier)->second.cube->setFileTime(fileTime);
+    LOG(INFO) << "Wrote " << current->sizeFilledCells() << " cells of cube '"
+              << current->getName() << "' to its file in "
+              << timer.elapsed().wall / 1e9 << " s.";
+  } catch (const ErrorException& e) {
+    LOG(ERROR) << "Writing cube '" << current->getName()
+               << "' to its file failed, the journal is kept: "
+               << e.getMessage();
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    Entry& entry = entries.find(identifier)->second;
+    entry.checkpointing = false;
+    if (entry.reloading) {
+      loaders.submit(boost::bind(&CubeCache::loadVersion, this, identifier));
+    }
+  }
+  release(identifier);
+}
+
+bool CubeCache::isLoaded(IdentifierType identifier) {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  auto it = entries.find(identifier);
+  return it != entries.end() && it->second.state == LOADED;
+}
+
+vector<pair<IdentifierType, boost::shared_ptr<Cube> > >
+CubeCache::getLoadedCubes() {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  vector<pair<IdentifierType, boost::shared_ptr<Cube> > > result;
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it->second.state == LOADED) {
+      result.push_back(make_pair(it->first, it->second.cube));
+    }
+  }
+  return result;
+}
+
+size_t CubeCache::getMemoryUsage() {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  return getLoadedMemory();
+}
+
+void CubeCache::startLoad(IdentifierType identifier, Entry* entry) {
+  entry->state = LOADING;
+  loaders.submit(boost::bind(&CubeCache::load, this, identifier));
+}
+
+void CubeCache::load(IdentifierType identifier) {
+  // the entry is not changed by other threads while it is loading
+  Entry& entry = entries.find(identifier)->second;
+  Cube* cube = entry.cube.get();
+  LOG(INFO) << "Loading cube '" << cube->getName() << "'.";
+
+  bool loaded = true;
+  try {
+    cube->loadCube();
+    if (entry.journal) {
+      replayJournal(entry.journal.get(), cube);
+    }
+    LOG(INFO) << "Loaded " << cube->sizeFilledCells() << " base cells into '"
+              << cube->getName() << "' in " << cube->getLoadTime() << " s ("
+              << cube->getMemoryUsage() << " bytes).";
+  } catch (const ErrorException& e) {
+    LOG(ERROR) << "Loading cube '" << cube->getName() << "' failed: "
+               << e.getMessage();
+    cube->unloadCube();
+    loaded = false;
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    entry.state = loaded ? LOADED : FAILED;
+    entry.lastUse = ++useCounter;
+    if (entry.reloading && loaded) {
+      loaders.submit(boost::bind(&CubeCache::loadVersion, this, identifier));
+    } else {
+      entry.reloading = false;
+    }
+    evict(&entry);
+  }
+  stateChanged.notify_all();
+}
+
+void CubeCache::loadVersion(IdentifierType identifier) {
+  boost::shared_ptr<Cube> current;
+  boost::shared_ptr<Journal> journal;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    current = entries.find(identifier)->second.cube;
+    journal = entries.find(identifier)->second.journal;
+  }
+
+  // the new version shares the dimensions with the current one
+  vector<Dimension*> dimensions = *current->getDimensions();
+  boost::shared_ptr<Cube> version(
+      new Cube(current->getName(), *current->getFileName(), &dimensions));
+  version->setColumnar(current->isColumnar());
+  LOG(INFO) << "Reloading cube '" << version->getName() << "'.";
+
+  bool loaded = true;
+  try {
+    version->loadCube();
+    if (journal) {
+      replayJournal(journal.get(), version.get());
+    }
+    LOG(INFO) << "Reloaded " << version->sizeFilledCells()
+              << " base cells into '" << version->getName() << "' in "
+              << version->getLoadTime() << " s ("
+              << version->getMemoryUsage() << " bytes).";
+  } catch (const ErrorException& e) {
+    LOG(ERROR) << "Reloading cube '" << version->getName()
+               << "' failed, the loaded version is kept: " << e.getMessage();
+    loaded = false;
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    Entry& entry = entries.find(identifier)->second;
+    entry.reloading = false;
+    // if the cube was unloaded meanwhile, it may be loading from the new file
+    // already. Queries still using the current version keep it until they
+    // have finished.
+    if (loaded && entry.state != LOADING) {
+      entry.cube = version;
+      entry.state = LOADED;
+      entry.lastUse = ++useCounter;
+      evict(&entry);
+    }
+  }
+  stateChanged.notify_all();
+}
+
+void CubeCache::watchFiles() {
+  // modification times of changed files seen by the last check. A file is
+  // reloaded if it has not changed again for one interval, so that files
+  // which are still being written are not loaded.
+  map<IdentifierType, time_t> changed;
+  try {
+    while (true) {
+      boost::this_thread::sleep(boost::posix_time::milliseconds(
+          static_cast<int64_t>(reloadInterval * 1000)));
+
+      // the file times are read with the mutex held, since a checkpoint sets
+      // the file time of the loaded version
+      vector<pair<IdentifierType, boost::shared_ptr<Cube> > > loaded;
+      map<IdentifierType, time_t> fileTimes;
+      {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+          if (it->second.state == LOADED) {
+            loaded.push_back(make_pair(it->first, it->second.cube));
+            fileTimes[it->first] = it->second.cube->getFileTime();
+          }
+        }
+      }
+
+      for (auto it = loaded.begin(); it != loaded.end(); ++it) {
+        Cube* cube = it->second.get();
+        time_t fileTime = FileUtils::getModificationTime(
+            FileName(*cube->getFileName(), "csv"));
+        if (fileTime == 0 || fileTime == fileTimes[it->first]) {
+          changed.erase(it->first);
+        } else if (changed[it->first] == fileTime) {
+          LOG(INFO) << "The file of cube '" << cube->getName()
+                    << "' has changed.";
+          reload(it->first);
+          changed.erase(it->first);
+        } else {
+          changed[it->first] = fileTime;
+        }
+      }
+    }
+  } catch (const boost::thread_interrupted&) {
+    // the cache is destroyed
+  }
+}
+
+void CubeCache::evict(const Entry* keep) {
+  if (memoryBudget == 0) {
+    return;
+  }
+
+  size_t memory = getLoadedMemory();
+  while (memory > memoryBudget) {
+    Entry* victim = NULL;
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      Entry& entry = it->second;
+      if (entry.state == LOADED && entry.pins == 0 && &entry != keep
+          && (victim == NULL || entry.lastUse < victim->lastUse)) {
+        victim = &entry;
+      }
+    }
+    if (victim == NULL) {
+      LOG(WARNING) << "The loaded cubes use " << memory
+                   << " bytes, but none of them can be unloaded.";
+      return;
+    }
+
+    LOG(INFO) << "Unloading cube '" << victim->cube->getName()
+              << "' to meet the memory budget.";
+    memory -= victim->cube->getMemoryUsage();
+
+    // the loaded version is not changed, other threads may still read it
+    // (see getLoadedCubes). An empty version with the same file replaces it
+    // and the loaded one is freed by its last owner.
+    Cube* loaded = victim->cube.get();
+    vector<Dimension*> dimensions = *loaded->getDimensions();
+    victim->cube.reset(
+        new Cube(loaded->getName(), *loaded->getFileName(), &dimensions));
+    victim->cube->setColumnar(loaded->isColumnar());
+    victim->state = UNLOADED;
+  }
+}
+
+size_t CubeCache::getLoadedMemory() const {
+  size_t memory = 0;
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it->second.state == LOADED) {
+      memory += it->second.cube->getMemoryUsage();
+    }
+  }
+  return memory;
+}
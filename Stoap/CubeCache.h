@@ -0,0 +1,226 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#ifndef STOAP_STOAP_CUBECACHE_H_
+#define STOAP_STOAP_CUBECACHE_H_ 1
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <map>
+#include <vector>
+
+#include "Olap.h"
+#include "InputOutput/Journal.h"
+#include "Olap/Cube.h"
+#include "Stoap/WorkerPool.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief loads the usable cubes on demand and evicts unused ones
+///
+/// Cubes are loaded in the background, either when they are requested for
+/// the first time or when they are prefetched. Queries pin the cube they use,
+/// so it cannot be unloaded while they run. If the loaded cubes use more
+/// memory than the budget, the least recently used cubes which are not pinned
+/// are unloaded.
+///
+/// A loaded cube can be reloaded from its file without blocking queries. The
+/// new version is loaded into a fresh cube in the background and swapped in
+/// when it is complete. Queries keep the version they pinned, the old version
+/// is freed when the last of them has finished. Changes of the cells are
+/// applied the same way to a copy of the loaded version, so queries see
+/// either all or none of them. The copy shares the base storage and only
+/// copies the changes (see Cube). Once there are many changes, they are
+/// merged into a new base storage in the background.
+///
+/// With a journal, every change is written to the journal of the cube before
+/// it is acknowledged, and the journal is replayed whenever the cube is
+/// loaded. Once the journal has grown too large, the loaded version is
+/// written to the cube file in the background and the journal is truncated
+/// (checkpoint).
+////////////////////////////////////////////////////////////////////////////////
+
+class CubeCache {
+ public:
+  // pins a cube for the lifetime of the object
+  class Pin {
+   public:
+    // throws an ErrorException if the cube is not available
+    Pin(CubeCache* cache, IdentifierType identifier)
+        : cache(cache),
+          identifier(identifier),
+          cube(cache->acquire(identifier)) {
+    }
+
+    ~Pin() {
+      cache->release(identifier);
+    }
+
+    Cube* get() const {
+      return cube.get();
+    }
+
+   private:
+    Pin(const Pin&);
+    Pin& operator=(const Pin&);
+
+    CubeCache* cache;
+    IdentifierType identifier;
+    boost::shared_ptr<Cube> cube;
+  };
+
+  // takes ownership of the cubes. memoryBudget is the number of bytes the
+  // loaded cubes may use, 0 means unlimited. Requests wait up to loadTimeout
+  // seconds for a cube to load. If reloadInterval is not 0, the files of the
+  // loaded cubes are checked every reloadInterval seconds and changed cubes
+  // are reloaded. If journalSize is not 0, the changes are written to a
+  // journal next to each cube file, which is checkpointed once it is larger
+  // than journalSize bytes.
+  CubeCache(const map<IdentifierType, Cube*>& cubes, size_t numLoaders,
+            size_t memoryBudget, double loadTimeout, double reloadInterval,
+            size_t journalSize);
+
+  ~CubeCache();
+
+  // start loading the cube in the background unless it is loaded already
+  void prefetch(IdentifierType identifier);
+
+  // wait until all cubes being loaded are loaded or failed to load
+  void waitForLoads();
+
+  // wait until the cube is loaded and pin it. Throws an ErrorException if
+  // the cube does not exist, could not be loaded or is still being loaded
+  // after the timeout.
+  boost::shared_ptr<Cube> acquire(IdentifierType identifier);
+
+  // unpin a cube returned by acquire
+  void release(IdentifierType identifier);
+
+  // reload the cube from its file in the background. A cube which is not
+  // loaded is read from the current file on its next request. Throws an
+  // ErrorException if the cube does not exist.
+  void reload(IdentifierType identifier);
+
+  // apply the cells to a copy of the cube, which is loaded if necessary,
+  // and swap it in. Without a journal, the changes are lost when the cube is
+  // unloaded or reloaded. With a journal, the function returns once the
+  // change has been written to the disk. If it cannot be written, the change
+  // is undone and the cube is reloaded. Throws an ErrorException if the
+  // cube is not available or the change fails.
+  Cube::DeltaCounts changeCube(IdentifierType identifier,
+                               const vector<pair<CellKeyType, double> >& cells,
+                               Cube::DeltaMode mode);
+
+  // whether the cube is loaded
+  bool isLoaded(IdentifierType identifier);
+
+  // the loaded cubes ordered by id
+  vector<pair<IdentifierType, boost::shared_ptr<Cube> > > getLoadedCubes();
+
+  // memory used by the loaded cubes
+  size_t getMemoryUsage();
+
+ private:
+  CubeCache(const CubeCache&);
+  CubeCache& operator=(const CubeCache&);
+
+  enum State {
+    UNLOADED,
+    LOADING,
+    LOADED,
+    FAILED
+  };
+
+  struct Entry {
+    boost::shared_ptr<Cube> cube;
+    State state;
+    // a new version of the loaded cube is being loaded
+    bool reloading;
+    // the changes of the cube are being merged into its base storage
+    bool compacting;
+    // the cube is being written to its file
+    bool checkpointing;
+    // journal of the changes, NULL without a journal
+    boost::shared_ptr<Journal> journal;
+    // held while the cube is changed, so concurrent changes are not lost
+    boost::mutex changeMutex;
+    size_t pins;
+    uint64_t lastUse;
+  };
+
+  // start loading the cube, the mutex must be held
+  void startLoad(IdentifierType identifier, Entry* entry);
+
+  // load a cube, executed by the loaders
+  void load(IdentifierType identifier);
+
+  // load a new version of a cube and swap it in, executed by the loaders
+  void loadVersion(IdentifierType identifier);
+
+  // merge the changes of a cube into a new version, executed by the loaders
+  void compact(IdentifierType identifier);
+
+  // apply the journal of the cube to a version which was loaded from the cube
+  // file
+  void replayJournal(Journal* journal, Cube* cube);
+
+  // write the cube to its file and truncate its journal, executed by the
+  // loaders
+  void checkpoint(IdentifierType identifier);
+
+  // reload the cubes whose files have changed, executed by the watcher
+  void watchFiles();
+
+  // unload least recently used cubes except keep until the budget is met,
+  // the mutex must be held
+  void evict(const Entry* keep);
+
+  // memory used by the loaded cubes, the mutex must be held
+  size_t getLoadedMemory() const;
+
+  // the changes are merged once there are more than kMinCompactionCells and
+  // more than 1 / kCompactionRatio of the cells
+  static const size_t kMinCompactionCells = 4096;
+  static const size_t kCompactionRatio = 16;
+
+  boost::mutex mutex;
+  boost::condition_variable stateChanged;
+  map<IdentifierType, Entry> entries;
+  uint64_t useCounter;
+  size_t memoryBudget;
+  double loadTimeout;
+  double reloadInterval;
+  size_t journalSize;
+  boost::thread* watcher;
+
+  // declared last, so the loaders finish before the entries are destroyed
+  WorkerPool loaders;
+};
+
+#endif  // STOAP_STOAP_CUBECACHE_H_
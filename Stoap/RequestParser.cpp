@@ -0,0 +1,250 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#include "Stoap/RequestParser.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmath>
+
+#include <string>
+#include <vector>
+
+#include "Exceptions/ErrorException.h"
+
+const size_t RequestParser::kMaxParams;
+
+bool RequestParser::Slice::operator==(const char* text) const {
+  size_t length = strlen(text);
+  return length == size() && memcmp(begin, text, length) == 0;
+}
+
+RequestParser::RequestParser(const string& request)
+    : begin(request.data()),
+      end(request.data() + request.size()),
+      numParams(0) {
+}
+
+bool RequestParser::nextToken(Slice* list, char separator, Slice* token) {
+  if (list->empty()) {
+    return false;
+  }
+
+  const char* pos = static_cast<const char*>(
+      memchr(list->begin, separator, list->size()));
+  if (pos == NULL) {
+    *token = *list;
+    list->begin = list->end;
+  } else {
+    *token = Slice(list->begin, pos);
+    list->begin = pos + 1;
+  }
+  return true;
+}
+
+bool RequestParser::parse() {
+  Slice request(begin, end);
+  Slice parts[2];
+  size_t numParts = 0;
+  Slice token;
+  while (nextToken(&request, '?', &token)) {
+    if (numParts == 2) {
+      return false;
+    }
+    parts[numParts++] = token;
+  }
+  if (numParts != 2) {
+    return false;
+  }
+  path = parts[0];
+
+  Slice params = parts[1];
+  Slice param;
+  numParams = 0;
+  while (nextToken(&params, '&', &param)) {
+    // skip everything which is not of the form name=value
+    Slice name;
+    Slice value;
+    Slice rest;
+    if (!nextToken(&param, '=', &name) || !nextToken(&param, '=', &value)
+        || nextToken(&param, '=', &rest)) {
+      continue;
+    }
+
+    if (numParams == kMaxParams) {
+      throwError("too many parameters", name.begin);
+    }
+    names[numParams] = name;
+    values[numParams] = value;
+    numParams++;
+  }
+  return true;
+}
+
+const RequestParser::Slice* RequestParser::getParam(const char* name) const {
+  for (size_t i = numParams; i > 0; i--) {
+    if (names[i - 1] == name) {
+      return &values[i - 1];
+    }
+  }
+  return NULL;
+}
+
+void RequestParser::parsePaths(const Slice& value,
+                               const vector<Dimension*>& dimensions,
+                               vector<CellKeyType>* paths) const {
+  // one or more paths can be given like the following:
+  // 0,5,0,2,8,2:0,5,0,3,8,2:...:...
+  paths->reserve(paths->size() + std::count(value.begin, value.end, ':') + 1);
+
+  Slice list = value;
+  Slice path;
+  while (nextToken(&list, ':', &path)) {
+    Slice elements = path;
+    Slice element;
+    size_t numElements = 0;
+    while (nextToken(&elements, ',', &element)) {
+      numElements++;
+    }
+    if (numElements != dimensions.size()) {
+      throwError("wrong number of elements in requested cellpath",
+                 path.begin);
+    }
+
+    paths->resize(paths->size() + 1);
+    CellKeyType& ids = paths->back();
+    elements = path;
+    for (size_t dimNum = 0; nextToken(&elements, ',', &element); dimNum++) {
+      ids.push_back(parseElement(element, dimensions[dimNum], dimNum));
+    }
+  }
+}
+
+void RequestParser::parseArea(const Slice& value,
+                              const vector<Dimension*>& dimensions,
+                              vector<IdentifiersType>* area) const {
+  // an area can be given like the following:
+  // el1:el2:...:el3 from dim1,el1:el2:...:eln from dim2,...
+  // example: 0,0,0,0:1:2:35:79:325,0:1:2:20:43:65:433,0,8,0
+  Slice list = value;
+  Slice elements;
+  size_t numDimensions = 0;
+  while (nextToken(&list, ',', &elements)) {
+    numDimensions++;
+  }
+  if (numDimensions != dimensions.size()) {
+    throwError("wrong number of dimensions in requested areapath",
+               value.begin);
+  }
+
+  area->resize(dimensions.size());
+  list = value;
+  for (size_t dimNum = 0; nextToken(&list, ',', &elements); dimNum++) {
+    if (elements.empty()) {
+      throwError(
+          "no element ids for at least one dimension in requested areapath",
+          elements.begin);
+    }
+
+    IdentifiersType& ids = area->at(dimNum);
+    ids.reserve(std::count(elements.begin, elements.end, ':') + 1);
+    Slice element;
+    while (nextToken(&elements, ':', &element)) {
+      ids.push_back(parseElement(element, dimensions[dimNum], dimNum));
+    }
+  }
+}
+
+void RequestParser::parseValues(const Slice& value,
+                                vector<double>* values) const {
+  values->reserve(values->size() + std::count(value.begin, value.end, ':') + 1);
+
+  Slice list = value;
+  Slice token;
+  while (nextToken(&list, ':', &token)) {
+    // only plain decimal numbers, strtod would accept hex, inf and nan, too
+    const char* pos = token.begin;
+    while (pos != token.end && strchr("0123456789+-.eE", *pos) != NULL) {
+      ++pos;
+    }
+    if (token.empty() || pos != token.end) {
+      throwError("invalid cell value '" + token.str() + "'", pos);
+    }
+    char* numberEnd;
+    double number = strtod(token.begin, &numberEnd);
+    if (numberEnd != token.end || !std::isfinite(number)) {
+      throwError("invalid cell value '" + token.str() + "'", numberEnd);
+    }
+    values->push_back(number);
+  }
+}
+
+uint32_t RequestParser::parseNumber(const Slice& token,
+                                    const char* what) const {
+  const size_t kMaxDigits = 10;
+
+  if (token.empty() || token.size() > kMaxDigits) {
+    throwError(string("invalid ") + what + " '" + token.str() + "'",
+               token.begin);
+  }
+
+  uint64_t number = 0;
+  for (const char* pos = token.begin; pos != token.end; ++pos) {
+    if (*pos < '0' || *pos > '9') {
+      throwError(string("invalid ") + what + " '" + token.str() + "'", pos);
+    }
+    number = number * 10 + (*pos - '0');
+  }
+  if (number > numeric_limits<uint32_t>::max()) {
+    throwError(string("invalid ") + what + " '" + token.str() + "'",
+               token.begin);
+  }
+  return static_cast<uint32_t>(number);
+}
+
+IdentifierType RequestParser::parseElement(const Slice& token,
+                                           Dimension* dimension,
+                                           size_t dimNum) const {
+  IdentifierType elemId = parseNumber(token, "element id");
+  if (dimension->lookupElement(elemId) == 0) {
+    std::ostringstream stringStream;
+    stringStream << "requested element " << elemId
+                 << " does not exist in dimension " << (dimNum + 1);
+    throwError(stringStream.str(), token.begin);
+  }
+  return elemId;
+}
+
+void RequestParser::throwError(const string& message,
+                               const char* position) const {
+  std::ostringstream stringStream;
+  stringStream << message << " (position " << (position - begin) << ")";
+  throw ErrorException(ErrorException::ERROR_INVALID_COORDINATES,
+                       stringStream.str());
+}
@@ -0,0 +1,135 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#ifndef STOAP_STOAP_REQUESTPARSER_H_
+#define STOAP_STOAP_REQUESTPARSER_H_ 1
+
+#include <string>
+#include <vector>
+
+#include "Olap.h"
+#include "Olap/Dimension.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief single pass parser for server requests
+///
+/// Parses requests of the form /request?param1=value1&param2=value2 in place.
+/// The request path, the parameter names and values are kept as slices of
+/// the request buffer, so nothing is copied or allocated. Element ids are
+/// parsed directly into the keys of the query and validated against the
+/// dimensions of the cube. All errors are thrown as ErrorException with the
+/// position of the offending character in the request.
+///
+/// Lists are split like StringUtils::splitString: a single trailing
+/// separator is ignored and parameters which do not consist of exactly one
+/// name and one non-empty value are skipped.
+////////////////////////////////////////////////////////////////////////////////
+
+class RequestParser {
+ public:
+  struct Slice {
+    Slice()
+        : begin(0),
+          end(0) {
+    }
+    Slice(const char* begin, const char* end)
+        : begin(begin),
+          end(end) {
+    }
+
+    size_t size() const {
+      return end - begin;
+    }
+
+    bool empty() const {
+      return begin == end;
+    }
+
+    bool operator==(const char* text) const;
+
+    bool operator!=(const char* text) const {
+      return !(*this == text);
+    }
+
+    string str() const {
+      return string(begin, end);
+    }
+
+    const char* begin;
+    const char* end;
+  };
+
+  static const size_t kMaxParams = 16;
+
+  explicit RequestParser(const string& request);
+
+  // split the request into its path and parameters, returns false if the
+  // request does not consist of a path and parameters separated by '?'
+  bool parse();
+
+  const Slice& getPath() const {
+    return path;
+  }
+
+  // value of the last parameter with the given name, NULL if not given
+  const Slice* getParam(const char* name) const;
+
+  // parse cell paths like 0,5,0,2:0,5,0,3 into paths
+  void parsePaths(const Slice& value, const vector<Dimension*>& dimensions,
+                  vector<CellKeyType>* paths) const;
+
+  // parse an area like 0:1,5,0:2:3,2 into area
+  void parseArea(const Slice& value, const vector<Dimension*>& dimensions,
+                 vector<IdentifiersType>* area) const;
+
+  // parse cell values like 1.5:-2:3e4 into values
+  void parseValues(const Slice& value, vector<double>* values) const;
+
+  // parse an unsigned decimal number, throws if token is not a number
+  uint32_t parseNumber(const Slice& token, const char* what) const;
+
+ private:
+  // returns the next token of list separated by separator in token
+  static bool nextToken(Slice* list, char separator, Slice* token);
+
+  // parse and validate an element id of the given dimension
+  IdentifierType parseElement(const Slice& token, Dimension* dimension,
+                              size_t dimNum) const;
+
+  // throw an ErrorException for the given position of the request
+  void throwError(const string& message, const char* position) const;
+
+  const char* begin;
+  const char* end;
+  Slice path;
+  Slice names[kMaxParams];
+  Slice values[kMaxParams];
+  size_t numParams;
+};
+
+#endif  // STOAP_STOAP_REQUESTPARSER_H_
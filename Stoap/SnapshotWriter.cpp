@@ -0,0 +1,215 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+#include "Stoap/SnapshotWriter.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <boost/bind.hpp>
+
+#include <string>
+
+#include "Collections/StringUtils.h"
+#include "Exceptions/ErrorException.h"
+#include "InputOutput/FileUtils.h"
+
+// messages sent by the child through the pipe
+struct SnapshotMessage {
+  enum Type {
+    WRITTEN_CELLS,
+    COPIED_BYTES
+  };
+
+  uint64_t type;
+  uint64_t value;
+};
+
+// send a message to the parent, messages are shorter than PIPE_BUF and
+// written atomically
+static void sendMessage(int fd, uint64_t type, uint64_t value) {
+  SnapshotMessage message = { type, value };
+  while (write(fd, &message, sizeof(message)) < 0 && errno == EINTR) {
+  }
+}
+
+// the private dirty memory of the process in bytes
+static size_t getPrivateDirty() {
+  FILE* file = fopen("/proc/self/smaps_rollup", "r");
+  if (file == NULL) {
+    file = fopen("/proc/self/smaps", "r");
+  }
+  if (file == NULL) {
+    return 0;
+  }
+
+  size_t bytes = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    unsigned long kilobytes;  // NOLINT(runtime/int)
+    if (sscanf(line, "Private_Dirty: %lu kB", &kilobytes) == 1) {
+      bytes += kilobytes * 1024;
+    }
+  }
+  fclose(file);
+  return bytes;
+}
+
+SnapshotWriter::SnapshotWriter() {
+}
+
+SnapshotWriter::~SnapshotWriter() {
+  monitors.join_all();
+}
+
+void SnapshotWriter::save(IdentifierType identifier, Cube* cube,
+                          const FileName& fileName) {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  Status& status = saves[identifier];
+  if (status.running) {
+    throw ErrorException(ErrorException::ERROR_INTERNAL,
+                         "cube " + StringUtils::convertToString(identifier)
+                             + " is being saved already");
+  }
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    throw ErrorException(ErrorException::ERROR_INTERNAL,
+                         "cannot create a pipe for the save");
+  }
+  status = Status();
+  status.fileName = fileName.fullPath();
+  status.totalCells = cube->sizeFilledCells();
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    // only the calling thread exists in the child, it must not take locks
+    // which might have been held by other threads of the parent
+    close(fds[0]);
+    writeSnapshot(identifier, cube, fileName, fds[1]);
+  }
+  close(fds[1]);
+  if (pid < 0) {
+    close(fds[0]);
+    throw ErrorException(ErrorException::ERROR_INTERNAL,
+                         "cannot create a process for the save");
+  }
+
+  status.running = true;
+  status.pid = pid;
+  status.timer.start();
+  monitors.create_thread(boost::bind(&SnapshotWriter::monitor, this,
+                                     identifier, fds[0]));
+}
+
+bool SnapshotWriter::getStatus(IdentifierType identifier, Status* status) {
+  boost::lock_guard<boost::mutex> lock(mutex);
+  auto it = saves.find(identifier);
+  if (it == saves.end()) {
+    return false;
+  }
+  *status = it->second;
+  if (status->running) {
+    status->seconds = status->timer.elapsed().wall / 1e9;
+  }
+  return true;
+}
+
+void SnapshotWriter::writeSnapshot(IdentifierType identifier, Cube* cube,
+                                   const FileName& fileName, int fd) {
+  // the handlers of the parent would exit like the server
+  signal(SIGINT, SIG_DFL);
+  signal(SIGQUIT, SIG_DFL);
+
+  // the file is written to a temp file first, so it is never incomplete
+  int exitCode = 0;
+  try {
+    FileName tempFileName(fileName, "tmp");
+    cube->saveCube(identifier, tempFileName,
+                   boost::bind(&sendMessage, fd,
+                               SnapshotMessage::WRITTEN_CELLS, _1));
+    if (!FileUtils::rename(tempFileName, fileName)) {
+      exitCode = 1;
+    }
+  } catch (...) {
+    exitCode = 1;
+  }
+
+  sendMessage(fd, SnapshotMessage::COPIED_BYTES, getPrivateDirty());
+  close(fd);
+  _exit(exitCode);
+}
+
+void SnapshotWriter::monitor(IdentifierType identifier, int fd) {
+  SnapshotMessage message;
+  ssize_t bytes;
+  while ((bytes = read(fd, &message, sizeof(message))) != 0) {
+    if (bytes < 0 && errno == EINTR) {
+      continue;
+    } else if (bytes != sizeof(message)) {
+      break;
+    }
+
+    boost::lock_guard<boost::mutex> lock(mutex);
+    Status& status = saves[identifier];
+    if (message.type == SnapshotMessage::WRITTEN_CELLS) {
+      status.writtenCells = message.value;
+      LOG(INFO) << "Saving cube " << identifier << ": "
+                << status.writtenCells << " of " << status.totalCells
+                << " cells written.";
+    } else if (message.type == SnapshotMessage::COPIED_BYTES) {
+      status.copiedBytes = message.value;
+    }
+  }
+  close(fd);
+
+  pid_t pid;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    pid = saves[identifier].pid;
+  }
+  int exitStatus = 0;
+  while (waitpid(pid, &exitStatus, 0) < 0 && errno == EINTR) {
+  }
+
+  boost::lock_guard<boost::mutex> lock(mutex);
+  Status& status = saves[identifier];
+  status.running = false;
+  status.failed = !WIFEXITED(exitStatus) || WEXITSTATUS(exitStatus) != 0;
+  status.seconds = status.timer.elapsed().wall / 1e9;
+  if (status.failed) {
+    LOG(ERROR) << "Saving cube " << identifier << " to '" << status.fileName
+               << "' failed after " << status.seconds << " s.";
+  } else {
+    LOG(INFO) << "Saved cube " << identifier << " to '" << status.fileName
+              << "': " << status.writtenCells << " cells in "
+              << status.seconds << " s, " << status.copiedBytes
+              << " bytes not shared with the server.";
+  }
+}
@@ -0,0 +1,106 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#ifndef STOAP_STOAP_SNAPSHOTWRITER_H_
+#define STOAP_STOAP_SNAPSHOTWRITER_H_ 1
+
+#include <sys/types.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <map>
+#include <string>
+
+#include "Olap.h"
+#include "Olap/Cube.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief writes cubes to files in child processes
+///
+/// A save forks the process. The child writes the cube from its copy of the
+/// memory, which is frozen at the time of the fork, while the parent keeps
+/// answering requests. Pages are only copied when one of the processes
+/// changes them. The child reports its progress and finally the memory it
+/// did not share with the parent through a pipe, which is read by a thread
+/// of the parent until the child has exited.
+////////////////////////////////////////////////////////////////////////////////
+
+class SnapshotWriter {
+ public:
+  struct Status {
+    Status()
+        : running(false),
+          failed(false),
+          pid(0),
+          totalCells(0),
+          writtenCells(0),
+          seconds(0),
+          copiedBytes(0) {
+    }
+
+    bool running;
+    bool failed;
+    pid_t pid;
+    string fileName;
+    size_t totalCells;
+    size_t writtenCells;
+    double seconds;  // duration of the save, updated when it has finished
+    size_t copiedBytes;  // memory of the child not shared with the parent
+    cpu_timer timer;
+  };
+
+  SnapshotWriter();
+
+  // waits until the running saves have finished
+  ~SnapshotWriter();
+
+  // fork a process which writes the cube to the file. The cube is not used
+  // by the parent afterwards. Throws an ErrorException if the cube is being
+  // saved already or the process cannot be created.
+  void save(IdentifierType identifier, Cube* cube, const FileName& fileName);
+
+  // the status of the running or the last save of the cube, returns false
+  // if the cube has not been saved
+  bool getStatus(IdentifierType identifier, Status* status);
+
+ private:
+  SnapshotWriter(const SnapshotWriter&);
+  SnapshotWriter& operator=(const SnapshotWriter&);
+
+  // write the cube and exit, executed by the child
+  static void writeSnapshot(IdentifierType identifier, Cube* cube,
+                            const FileName& fileName, int fd);
+
+  // read the messages of the child until it has exited
+  void monitor(IdentifierType identifier, int fd);
+
+  boost::mutex mutex;
+  map<IdentifierType, Status> saves;
+  boost::thread_group monitors;
+};
+
+#endif  // STOAP_STOAP_SNAPSHOTWRITER_H_
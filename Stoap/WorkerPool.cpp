@@ -0,0 +1,79 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#include "Stoap/WorkerPool.h"
+
+#include <boost/bind.hpp>
+
+#include "Collections/DeleteObject.h"
+
+WorkerPool::WorkerPool(size_t numWorkers)
+    : stopping(false) {
+  for (size_t i = 0; i < numWorkers; i++) {
+    workers.push_back(new boost::thread(boost::bind(&WorkerPool::run, this)));
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobAvailable.notify_all();
+  for (auto it = workers.begin(); it != workers.end(); ++it) {
+    (*it)->join();
+  }
+  for_each(workers.begin(), workers.end(), DeleteObject());
+}
+
+void WorkerPool::submit(const Job& job) {
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    jobs.push_back(job);
+  }
+  jobAvailable.notify_one();
+}
+
+void WorkerPool::run() {
+  while (true) {
+    Job job;
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      while (jobs.empty() && !stopping) {
+        jobAvailable.wait(lock);
+      }
+      // the queue is drained before the workers stop
+      if (jobs.empty()) {
+        return;
+      }
+      job.swap(jobs.front());
+      jobs.pop_front();
+    }
+    job();
+  }
+}
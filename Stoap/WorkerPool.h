@@ -0,0 +1,75 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#ifndef STOAP_STOAP_WORKERPOOL_H_
+#define STOAP_STOAP_WORKERPOOL_H_ 1
+
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+
+#include "Olap.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief fixed-size pool of threads executing queued jobs
+///
+/// Jobs are executed in submission order by the first idle worker. The
+/// destructor waits until all queued jobs have been executed.
+////////////////////////////////////////////////////////////////////////////////
+
+class WorkerPool {
+ public:
+  typedef boost::function<void()> Job;
+
+  explicit WorkerPool(size_t numWorkers);
+  ~WorkerPool();
+
+  // queue a job for execution by the next idle worker
+  void submit(const Job& job);
+
+  size_t size() const {
+    return workers.size();
+  }
+
+ private:
+  WorkerPool(const WorkerPool&);
+  WorkerPool& operator=(const WorkerPool&);
+
+  // main loop of a worker thread
+  void run();
+
+  boost::mutex mutex;
+  boost::condition_variable jobAvailable;
+  deque<Job> jobs;
+  bool stopping;
+  vector<boost::thread*> workers;
+};
+
+#endif  // STOAP_STOAP_WORKERPOOL_H_
@@ -0,0 +1,236 @@
+/*
+ *
+ * Copyright (C) 2006-2015 Jedox AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License (Version 2) as published
+ * by the Free Software Foundation at http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * If you are developing and distributing open source applications under the
+ * GPL License, then you are free to use Palo under the GPL License.  For OEMs,
+ * ISVs, and VARs who distribute Palo with their products, and do not license
+ * and distribute their source code under the GPL, Jedox provides a flexible
+ * OEM Commercial License.
+ *
+ * \author Jerome Meinke, University of Freiburg, Germany
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <iostream>
+#include <string>
+#include "Olap.h"
+#include "Collections/StringUtils.h"
+#include "Exceptions/ErrorException.h"
+#include "InputOutput/BinaryResult.h"
+
+// Reference client for the server mode. Sends a request to the input FIFO
+// and reads the answer from the output FIFO. Binary answers are decoded with
+// BinaryResultReader, text answers are only counted. The number of cells,
+// bytes and the throughput of every run are printed to stderr.
+//
+// With -c, the given number of clients send the request concurrently, each
+// receiving its answers on a private FIFO, and the total throughput is
+// printed. This is used to benchmark the worker threads of the server.
+
+// totals of the answers received by a client
+struct AnswerStats {
+  AnswerStats()
+      : requests(0),
+        cells(0),
+        found(0),
+        bytes(0),
+        failed(false) {
+  }
+
+  uint64_t requests;
+  uint64_t cells;
+  uint64_t found;
+  uint64_t bytes;
+  bool failed;
+};
+
+void printUsageAndExit() {
+  cerr << "Usage: ./stoapClient [options] <request>" << endl
+       << "Options:" << endl
+       << " -p: print the decoded cells as 'found;value' lines." << endl
+       << " -r <n>: send the request n times (default 1)." << endl
+       << " -c <n>: send the requests from n concurrent clients, each with a"
+       << endl
+       << "         private answer FIFO, and print the total throughput."
+       << endl;
+  exit(1);
+}
+
+// read an answer and add it to stats, returns true for binary answers
+bool readAnswer(istream* out, bool print, AnswerStats* stats) {
+  BinaryResultReader reader(out);
+  bool binary = reader.readHeader();
+  uint64_t cells = 0;
+  if (binary) {
+    bool isFound;
+    double value;
+    while (reader.next(&isFound, &value)) {
+      cells++;
+      stats->found += isFound;
+      if (print) {
+        cout << isFound << ";" << value << endl;
+      }
+    }
+    stats->bytes += sizeof(BinaryResult::Header) + cells * sizeof(double)
+        + (cells + BinaryResult::kBlockCells - 1) / BinaryResult::kBlockCells
+            * sizeof(uint64_t);
+  } else {
+    const string& text = reader.getMessage();
+    cells = std::count(text.begin(), text.end(), '\n');
+    stats->bytes += text.size();
+    if (print) {
+      cout << text;
+    }
+  }
+  stats->cells += cells;
+  stats->requests++;
+  return binary;
+}
+
+// send the request repeat times, answers are read from a private FIFO
+void runClient(const string& request, uint32_t replyId, int repeat,
+               AnswerStats* stats) {
+  string replyPath = string(FIFO_OUT) + "."
+      + StringUtils::convertToString(replyId);
+  unlink(replyPath.c_str());
+  if (mkfifo(replyPath.c_str(), 0666) != 0) {
+    cerr << "Error: cannot create " << replyPath << endl;
+    stats->failed = true;
+    return;
+  }
+
+  string line = request + "&reply=" + StringUtils::convertToString(replyId);
+  for (int run = 0; run < repeat && !stats->failed; run++) {
+    // short lines are written atomically, even if other clients write, too
+    ofstream in(FIFO_IN);
+    in << line << endl;
+    in.close();
+
+    ifstream out(replyPath.c_str());
+    try {
+      readAnswer(&out, false, stats);
+    } catch (const ErrorException& e) {
+      cerr << "Error: " << e.getMessage() << endl;
+      stats->failed = true;
+    }
+    // wait until the server has closed the FIFO, otherwise the next request
+    // could open it before and would read an empty answer
+    out.ignore(numeric_limits<streamsize>::max());
+  }
+  unlink(replyPath.c_str());
+}
+
+int main(int argc, char** argv) {
+  bool print = false;
+  int repeat = 1;
+  int clients = 0;
+
+  int c;
+  while ((c = getopt(argc, argv, "pr:c:")) != -1) {
+    switch (c) {
+      case 'p':
+        print = true;
+        break;
+      case 'r':
+        repeat = atoi(optarg);
+        break;
+      case 'c':
+        clients = atoi(optarg);
+        if (clients < 1 || clients > 255) {
+          printUsageAndExit();
+        }
+        break;
+      default:
+        printUsageAndExit();
+    }
+  }
+  if (optind + 1 != argc || repeat < 1) {
+    printUsageAndExit();
+  }
+  string request(argv[optind]);
+  cout << setprecision(numeric_limits<double>::digits10);
+
+  if (clients > 0) {
+    vector<AnswerStats> stats(clients);
+    cpu_timer timer;
+    boost::thread_group threads;
+    for (int client = 0; client < clients; client++) {
+      // the reply ids of the clients are unique among all processes
+      uint32_t replyId = (static_cast<uint32_t>(getpid()) << 8) | client;
+      threads.create_thread(boost::bind(&runClient, request, replyId, repeat,
+                                        &stats[client]));
+    }
+    threads.join_all();
+    double seconds = timer.elapsed().wall / 1e9;
+
+    AnswerStats total;
+    for (auto it = stats.begin(); it != stats.end(); ++it) {
+      total.requests += it->requests;
+      total.cells += it->cells;
+      total.bytes += it->bytes;
+      total.failed = total.failed || it->failed;
+    }
+    cerr << clients << " clients: " << total.requests << " requests, "
+         << total.cells << " cells, " << total.bytes << " bytes in "
+         << seconds << " s, " << (total.requests / seconds)
+         << " requests/s, " << (total.bytes / seconds / 1e6) << " MB/s"
+         << endl;
+    return total.failed ? 1 : 0;
+  }
+
+  for (int run = 0; run < repeat; run++) {
+    cpu_timer timer;
+
+    ofstream in(FIFO_IN);
+    in << request << endl;
+    in.close();
+
+    ifstream out(FIFO_OUT);
+    if (!out) {
+      cerr << "Error: cannot open " << FIFO_OUT << endl;
+      return 1;
+    }
+
+    AnswerStats stats;
+    bool binary = false;
+    try {
+      binary = readAnswer(&out, print, &stats);
+    } catch (const ErrorException& e) {
+      cerr << "Error: " << e.getMessage() << endl;
+      return 1;
+    }
+
+    double seconds = timer.elapsed().wall / 1e9;
+    cerr << "run " << run << ": " << stats.cells << " cells";
+    if (binary) {
+      cerr << " (" << stats.found << " found)";
+    }
+    cerr << ", " << stats.bytes << " bytes in " << seconds << " s, "
+         << (stats.bytes / seconds / 1e6) << " MB/s" << endl;
+
+    // give the server time to wait for the next request
+    usleep(100000);
+  }
+  return 0;
+}